@@ -0,0 +1,325 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dkim.h"
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <openssl/bio.h>
+#include <openssl/pem.h>
+#include <vector>
+
+namespace ez {
+namespace smtp {
+namespace {
+
+bool IsWhitespace(char c) { return c == ' ' || c == '\t'; }
+
+std::string ToLower(absl::string_view text) {
+  std::string result(text);
+  std::transform(result.begin(), result.end(), result.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return result;
+}
+
+std::string Base64Encode(const unsigned char *data, size_t size) {
+  std::string result(4 * ((size + 2) / 3), '\0');
+  int length = EVP_EncodeBlock(reinterpret_cast<unsigned char *>(&result[0]),
+                               data, static_cast<int>(size));
+  result.resize(length);
+  return result;
+}
+
+// Splits a block of CRLF terminated header fields into fields, keeping
+// folded continuation lines with their field.
+std::vector<absl::string_view> SplitHeaders(absl::string_view headers) {
+  std::vector<absl::string_view> fields;
+  size_t start = 0;
+  size_t pos = 0;
+  while ((pos = headers.find("\r\n", pos)) != absl::string_view::npos) {
+    pos += 2;
+    if (pos < headers.size() && IsWhitespace(headers[pos])) {
+      continue;
+    }
+    fields.push_back(headers.substr(start, pos - 2 - start));
+    start = pos;
+  }
+  if (start < headers.size()) {
+    fields.push_back(headers.substr(start));
+  }
+  return fields;
+}
+
+bool IsSignedHeader(absl::string_view name) {
+  static const char *const kSignedHeaders[] = {
+      "from", "to", "cc", "subject", "mime-version", "content-type"};
+  for (const char *signed_header : kSignedHeaders) {
+    if (name == signed_header) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Folds a base64 value so that no line exceeds the recommended length.
+std::string Fold(absl::string_view value, size_t first_line, size_t width) {
+  std::string result(value.substr(0, first_line));
+  for (size_t pos = first_line; pos < value.size(); pos += width) {
+    absl::StrAppend(&result, "\r\n\t", value.substr(pos, width));
+  }
+  return result;
+}
+
+} // namespace
+
+DkimBodyHash::DkimBodyHash()
+    : context_(EVP_MD_CTX_new(), EVP_MD_CTX_free), buffered_(0),
+      whitespace_(false), carriage_return_(false), line_breaks_(0),
+      has_content_(false) {
+  EVP_DigestInit_ex(context_.get(), EVP_sha256(), nullptr);
+}
+
+void DkimBodyHash::Update(absl::string_view chunk) {
+  const char *p = chunk.data();
+  const char *end = p + chunk.size();
+  while (p < end) {
+    if (carriage_return_) {
+      carriage_return_ = false;
+      if (*p == '\n') {
+        // Whitespace at the end of a line is dropped, and line breaks are
+        // held back in case they turn out to be trailing empty lines.
+        whitespace_ = false;
+        line_breaks_++;
+        p++;
+        continue;
+      }
+      Write("\r", 1);
+    }
+    const char *start = p;
+    while (p < end && !IsWhitespace(*p) && *p != '\r') {
+      p++;
+    }
+    if (p > start) {
+      Write(start, p - start);
+    }
+    if (p == end) {
+      break;
+    }
+    if (*p == '\r') {
+      carriage_return_ = true;
+    } else {
+      whitespace_ = true;
+    }
+    p++;
+  }
+}
+
+std::string DkimBodyHash::Final() {
+  if (carriage_return_) {
+    carriage_return_ = false;
+    Write("\r", 1);
+  }
+  // A non-empty body always ends with exactly one line break.
+  if (has_content_) {
+    line_breaks_ = 1;
+    whitespace_ = false;
+    WritePending();
+  }
+  Flush();
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int size = 0;
+  EVP_DigestFinal_ex(context_.get(), digest, &size);
+  return Base64Encode(digest, size);
+}
+
+void DkimBodyHash::Write(const char *data, size_t size) {
+  WritePending();
+  has_content_ = true;
+  if (buffered_ + size > sizeof(buffer_)) {
+    Flush();
+    if (size >= sizeof(buffer_)) {
+      EVP_DigestUpdate(context_.get(), data, size);
+      return;
+    }
+  }
+  memcpy(buffer_ + buffered_, data, size);
+  buffered_ += size;
+}
+
+void DkimBodyHash::WritePending() {
+  // Line breaks and whitespace are only written once followed by content.
+  for (; line_breaks_ > 0; line_breaks_--) {
+    if (buffered_ + 2 > sizeof(buffer_)) {
+      Flush();
+    }
+    buffer_[buffered_++] = '\r';
+    buffer_[buffered_++] = '\n';
+  }
+  if (whitespace_) {
+    if (buffered_ + 1 > sizeof(buffer_)) {
+      Flush();
+    }
+    buffer_[buffered_++] = ' ';
+    whitespace_ = false;
+  }
+}
+
+void DkimBodyHash::Flush() {
+  if (buffered_ > 0) {
+    EVP_DigestUpdate(context_.get(), buffer_, buffered_);
+    buffered_ = 0;
+  }
+}
+
+std::string CanonicalizeHeaderRelaxed(absl::string_view header) {
+  size_t colon = header.find(':');
+  absl::string_view name = header.substr(0, colon);
+  while (!name.empty() && IsWhitespace(name.back())) {
+    name.remove_suffix(1);
+  }
+  std::string result = ToLower(name);
+  result += ':';
+  if (colon == absl::string_view::npos) {
+    return result;
+  }
+  bool whitespace = false;
+  bool has_value = false;
+  for (size_t i = colon + 1; i < header.size(); i++) {
+    char c = header[i];
+    if (c == '\r' && i + 1 < header.size() && header[i + 1] == '\n') {
+      i++;
+      continue;
+    }
+    if (IsWhitespace(c)) {
+      whitespace = true;
+      continue;
+    }
+    if (whitespace && has_value) {
+      result += ' ';
+    }
+    whitespace = false;
+    has_value = true;
+    result += c;
+  }
+  return result;
+}
+
+absl::Status DkimSigner::AddKey(absl::string_view domain,
+                                absl::string_view selector,
+                                absl::string_view private_key_pem) {
+  std::unique_ptr<BIO, int (*)(BIO *)> bio(
+      BIO_new_mem_buf(private_key_pem.data(),
+                      static_cast<int>(private_key_pem.size())),
+      BIO_free);
+  EVP_PKEY *private_key =
+      PEM_read_bio_PrivateKey(bio.get(), nullptr, nullptr, nullptr);
+  if (private_key == nullptr) {
+    return absl::InvalidArgumentError("Unable to parse the DKIM private key");
+  }
+  Key key;
+  key.domain = ToLower(domain);
+  key.selector = std::string(selector);
+  key.private_key.reset(private_key, EVP_PKEY_free);
+  switch (EVP_PKEY_id(private_key)) {
+  case EVP_PKEY_RSA:
+    key.ed25519 = false;
+    break;
+  case EVP_PKEY_ED25519:
+    key.ed25519 = true;
+    break;
+  default:
+    return absl::InvalidArgumentError(
+        "DKIM keys must be either RSA or Ed25519");
+  }
+  std::string id = key.domain;
+  keys_[std::move(id)] = std::move(key);
+  return absl::OkStatus();
+}
+
+bool DkimSigner::HasKey(absl::string_view domain) const {
+  return keys_.find(ToLower(domain)) != keys_.end();
+}
+
+absl::StatusOr<std::string>
+DkimSigner::Sign(absl::string_view domain, absl::string_view headers,
+                 absl::string_view body_hash) const {
+  auto it = keys_.find(ToLower(domain));
+  if (it == keys_.end()) {
+    return absl::NotFoundError(
+        absl::StrCat("No DKIM key for domain ", domain));
+  }
+  const Key *key = &it->second;
+
+  std::string signed_data;
+  std::string signed_names;
+  for (absl::string_view field : SplitHeaders(headers)) {
+    std::string canonical = CanonicalizeHeaderRelaxed(field);
+    absl::string_view name =
+        absl::string_view(canonical).substr(0, canonical.find(':'));
+    if (!IsSignedHeader(name)) {
+      continue;
+    }
+    absl::StrAppend(&signed_names, signed_names.empty() ? "" : ":", name);
+    absl::StrAppend(&signed_data, canonical, "\r\n");
+  }
+
+  std::string signature_header = absl::StrCat(
+      "DKIM-Signature: v=1; a=", key->ed25519 ? "ed25519" : "rsa",
+      "-sha256; c=relaxed/relaxed; d=", key->domain, "; s=", key->selector,
+      ";\r\n\tt=", std::time(nullptr), "; h=", signed_names, ";\r\n\tbh=",
+      body_hash, ";\r\n\tb=");
+  signed_data += CanonicalizeHeaderRelaxed(signature_header);
+
+  std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX *)> context(
+      EVP_MD_CTX_new(), EVP_MD_CTX_free);
+  std::vector<unsigned char> signature;
+  size_t signature_size = 0;
+  bool ok;
+  if (key->ed25519) {
+    // RFC 8463 signs the SHA-256 hash of the data with PureEdDSA.
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    EVP_Digest(signed_data.data(), signed_data.size(), digest, &digest_size,
+               EVP_sha256(), nullptr);
+    ok = EVP_DigestSignInit(context.get(), nullptr, nullptr, nullptr,
+                            key->private_key.get()) == 1 &&
+         EVP_DigestSign(context.get(), nullptr, &signature_size, digest,
+                        digest_size) == 1;
+    signature.resize(signature_size);
+    ok = ok && EVP_DigestSign(context.get(), signature.data(), &signature_size,
+                              digest, digest_size) == 1;
+  } else {
+    const auto *data =
+        reinterpret_cast<const unsigned char *>(signed_data.data());
+    ok = EVP_DigestSignInit(context.get(), nullptr, EVP_sha256(), nullptr,
+                            key->private_key.get()) == 1 &&
+         EVP_DigestSign(context.get(), nullptr, &signature_size, data,
+                        signed_data.size()) == 1;
+    signature.resize(signature_size);
+    ok = ok && EVP_DigestSign(context.get(), signature.data(), &signature_size,
+                              data, signed_data.size()) == 1;
+  }
+  if (!ok) {
+    return absl::InternalError("Unable to compute the DKIM signature");
+  }
+  return absl::StrCat(
+      signature_header,
+      Fold(Base64Encode(signature.data(), signature_size), 70, 76), "\r\n");
+}
+
+} // namespace smtp
+} // namespace ez
@@ -0,0 +1,110 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_DKIM_H
+#define EZ_DKIM_H
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include <map>
+#include <memory>
+#include <openssl/evp.h>
+#include <string>
+
+namespace ez {
+namespace smtp {
+
+/** Computes the DKIM body hash (bh=) using relaxed canonicalization and
+ * SHA-256. The body may be passed in any number of chunks, which are
+ * canonicalized and hashed as they arrive without copying the body. */
+class DkimBodyHash {
+public:
+  DkimBodyHash();
+
+  /** Canonicalizes and hashes the next chunk of the body. */
+  void Update(absl::string_view chunk);
+
+  /** Returns the base64 encoded hash. Call once, after the last Update. */
+  std::string Final();
+
+private:
+  void Write(const char *data, size_t size);
+  void WritePending();
+  void Flush();
+
+  std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX *)> context_;
+  char buffer_[4096];
+  size_t buffered_;
+  // Whitespace seen since the last content on the line, which is collapsed
+  // to a single space if more content follows.
+  bool whitespace_;
+  // Whether the previous chunk ended with a CR.
+  bool carriage_return_;
+  // Line breaks that have not been written yet, since trailing empty lines
+  // are dropped.
+  int line_breaks_;
+  bool has_content_;
+};
+
+/** Canonicalizes a header field ("Name: value", optionally folded) using
+ * relaxed canonicalization, without the trailing CRLF. */
+std::string CanonicalizeHeaderRelaxed(absl::string_view header);
+
+/** Signs emails with DKIM (RFC 6376) using relaxed/relaxed canonicalization.
+ *
+ * Supports rsa-sha256 and ed25519-sha256 (RFC 8463). Keys are parsed once
+ * when added and cached by domain, one per domain. Add keys before sharing
+ * the signer between Smtp instances; signing is thread-safe.
+ *
+ *   auto signer = std::make_shared<DkimSigner>();
+ *   RETURN_IF_ERROR(signer->AddKey("example.com", "mail", private_key_pem));
+ *   smtp.SetDkimSigner(signer);
+ */
+class DkimSigner {
+public:
+  /** Parses a PEM encoded RSA or Ed25519 private key used to sign email from
+   * the domain, published under the selector. Replaces any key previously
+   * added for the domain, e.g. when rotating to a new selector. */
+  absl::Status AddKey(absl::string_view domain, absl::string_view selector,
+                      absl::string_view private_key_pem);
+
+  /** Returns whether a key has been added for the domain. */
+  bool HasKey(absl::string_view domain) const;
+
+  /** Returns the DKIM-Signature header field, including the trailing CRLF,
+   * for an email from the domain. The headers are CRLF terminated header
+   * fields; From, To, Cc, Subject, MIME-Version and Content-Type are signed.
+   * The body hash must be computed over the body as it will be sent. */
+  absl::StatusOr<std::string> Sign(absl::string_view domain,
+                                   absl::string_view headers,
+                                   absl::string_view body_hash) const;
+
+private:
+  struct Key {
+    std::string domain;
+    std::string selector;
+    std::shared_ptr<EVP_PKEY> private_key;
+    bool ed25519;
+  };
+
+  // Keyed by lower case domain. Domains may share a selector such as
+  // "default".
+  std::map<std::string, Key> keys_;
+};
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_DKIM_H
@@ -0,0 +1,123 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_format.h"
+#include "dkim.h"
+#include "smtp.h"
+#include <chrono>
+#include <iostream>
+#include <openssl/bio.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+ABSL_FLAG(int, emails, 2000, "Emails to send per measurement");
+
+using ez::smtp::DkimSigner;
+using ez::smtp::Smtp;
+using ez::smtp::SmtpAdapter;
+
+/** Accepts every command without doing any I/O, so that only the cost of
+ * building and signing the message is measured. */
+class NullSmtpAdapter : public SmtpAdapter {
+public:
+  absl::Status Connect() override { return absl::OkStatus(); }
+  absl::Status EnableTls() override { return absl::OkStatus(); }
+  absl::Status Read(int) override { return absl::OkStatus(); }
+  absl::Status WriteLine(absl::string_view) override {
+    return absl::OkStatus();
+  }
+  std::string Hostname() override { return "benchmark"; }
+  void Disconnect() override {}
+  void EnableLogging() override {}
+};
+
+std::string GenerateKey(int type) {
+  EVP_PKEY_CTX *context = EVP_PKEY_CTX_new_id(type, nullptr);
+  EVP_PKEY_keygen_init(context);
+  if (type == EVP_PKEY_RSA) {
+    EVP_PKEY_CTX_set_rsa_keygen_bits(context, 2048);
+  }
+  EVP_PKEY *key = nullptr;
+  EVP_PKEY_keygen(context, &key);
+  EVP_PKEY_CTX_free(context);
+  BIO *bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr);
+  char *data;
+  long size = BIO_get_mem_data(bio, &data);
+  std::string pem(data, size);
+  BIO_free(bio);
+  EVP_PKEY_free(key);
+  return pem;
+}
+
+double EmailsPerSecond(std::shared_ptr<const DkimSigner> signer,
+                       const std::string &body) {
+  Smtp smtp("username", "password", std::make_shared<NullSmtpAdapter>());
+  smtp.SetDkimSigner(signer);
+  if (!smtp.Connect().ok()) {
+    return 0;
+  }
+  const int emails = absl::GetFlag(FLAGS_emails);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < emails; i++) {
+    auto status = smtp.NewEmail()
+                      .SetSender("from@example.com")
+                      .AddRecipient("to@example.com", "Joe Smith")
+                      .SetSubject("Benchmark")
+                      .SetBody(body)
+                      .SendBatch();
+    if (!status.ok()) {
+      std::cerr << status << std::endl;
+      return 0;
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return emails / elapsed.count();
+}
+
+/** Prints the throughput of unsigned and DKIM signed emails for a range of
+ * body sizes. Example usage:
+ *
+ * bazel run -c opt :dkim_benchmark -- --emails=10000
+ */
+int main(int argc, char **argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  auto rsa = std::make_shared<DkimSigner>();
+  auto ed25519 = std::make_shared<DkimSigner>();
+  if (!rsa->AddKey("example.com", "rsa", GenerateKey(EVP_PKEY_RSA)).ok() ||
+      !ed25519->AddKey("example.com", "ed", GenerateKey(EVP_PKEY_ED25519))
+           .ok()) {
+    std::cerr << "Unable to generate keys" << std::endl;
+    return 1;
+  }
+
+  std::cout << "body bytes\tunsigned/s\trsa-sha256/s\ted25519-sha256/s"
+            << std::endl;
+  for (int size : {1 << 10, 16 << 10, 256 << 10}) {
+    std::string body;
+    while (body.size() < static_cast<size_t>(size)) {
+      body += "The quick brown fox jumps over the lazy dog.  \r\n";
+    }
+    std::cout << absl::StrFormat("%d\t%.0f\t%.0f\t%.0f", body.size(),
+                                 EmailsPerSecond(nullptr, body),
+                                 EmailsPerSecond(rsa, body),
+                                 EmailsPerSecond(ed25519, body))
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,222 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dkim.h"
+#include <gtest/gtest.h>
+
+#include "absl/status/status.h"
+#include <openssl/bio.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+namespace ez {
+namespace smtp {
+namespace {
+
+const char kHeaders[] = "From: from@example.com\r\n"
+                        "To: joe smith <to@example.com>\r\n"
+                        "Bcc: bcc@example.com\r\n"
+                        "Subject:  Hello\r\n"
+                        "  World \r\n";
+
+const std::vector<absl::string_view> kSignedFields = {
+    "From: from@example.com", "To: joe smith <to@example.com>",
+    "Subject:  Hello\r\n  World "};
+
+std::string BodyHash(absl::string_view body) {
+  DkimBodyHash body_hash;
+  body_hash.Update(body);
+  return body_hash.Final();
+}
+
+// Generates a private key of the given type, returning it in PEM format.
+std::string GenerateKey(int type) {
+  std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX *)> context(
+      EVP_PKEY_CTX_new_id(type, nullptr), EVP_PKEY_CTX_free);
+  EVP_PKEY_keygen_init(context.get());
+  if (type == EVP_PKEY_RSA) {
+    EVP_PKEY_CTX_set_rsa_keygen_bits(context.get(), 2048);
+  }
+  EVP_PKEY *key = nullptr;
+  EVP_PKEY_keygen(context.get(), &key);
+  std::unique_ptr<BIO, int (*)(BIO *)> bio(BIO_new(BIO_s_mem()), BIO_free);
+  PEM_write_bio_PrivateKey(bio.get(), key, nullptr, nullptr, 0, nullptr,
+                           nullptr);
+  EVP_PKEY_free(key);
+  char *data;
+  long size = BIO_get_mem_data(bio.get(), &data);
+  return std::string(data, size);
+}
+
+// Verifies the DKIM-Signature header against the signed header fields using
+// the public half of the PEM encoded private key.
+bool Verify(absl::string_view signature_header,
+            const std::vector<absl::string_view> &signed_fields,
+            const std::string &private_key_pem, bool ed25519) {
+  size_t b = signature_header.find("\tb=");
+  if (b == absl::string_view::npos) {
+    return false;
+  }
+  std::string data;
+  for (absl::string_view field : signed_fields) {
+    data += CanonicalizeHeaderRelaxed(field) + "\r\n";
+  }
+  data += CanonicalizeHeaderRelaxed(signature_header.substr(0, b + 3));
+
+  std::string encoded;
+  for (char c : signature_header.substr(b + 3)) {
+    if (!isspace(static_cast<unsigned char>(c))) {
+      encoded += c;
+    }
+  }
+  std::vector<unsigned char> signature(encoded.size());
+  int size = EVP_DecodeBlock(
+      signature.data(), reinterpret_cast<const unsigned char *>(encoded.data()),
+      encoded.size());
+  while (!encoded.empty() && encoded.back() == '=') {
+    encoded.pop_back();
+    size--;
+  }
+
+  std::unique_ptr<BIO, int (*)(BIO *)> bio(
+      BIO_new_mem_buf(private_key_pem.data(), private_key_pem.size()),
+      BIO_free);
+  std::unique_ptr<EVP_PKEY, void (*)(EVP_PKEY *)> key(
+      PEM_read_bio_PrivateKey(bio.get(), nullptr, nullptr, nullptr),
+      EVP_PKEY_free);
+  std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX *)> context(
+      EVP_MD_CTX_new(), EVP_MD_CTX_free);
+  if (ed25519) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    EVP_Digest(data.data(), data.size(), digest, &digest_size, EVP_sha256(),
+               nullptr);
+    EVP_DigestVerifyInit(context.get(), nullptr, nullptr, nullptr, key.get());
+    return EVP_DigestVerify(context.get(), signature.data(), size, digest,
+                            digest_size) == 1;
+  }
+  EVP_DigestVerifyInit(context.get(), nullptr, EVP_sha256(), nullptr,
+                       key.get());
+  return EVP_DigestVerify(context.get(), signature.data(), size,
+                          reinterpret_cast<const unsigned char *>(data.data()),
+                          data.size()) == 1;
+}
+
+TEST(DkimBodyHashTest, MatchesRfc8463Example) {
+  ASSERT_EQ(BodyHash("Hi.\r\n\r\nWe lost the game.  Are you hungry yet?  "
+                     "\r\n\r\nJoe.\r\n\r\n\r\n"),
+            "2jUSOH9NhtVGCQWNr9BrIAPreKQjO6Sn7XIkfJVOzv8=");
+}
+
+TEST(DkimBodyHashTest, EmptyBody) {
+  ASSERT_EQ(BodyHash(""), "47DEQpj8HBSa+/TImW+5JCeuQeRkm5NMpJWZG3hSuFU=");
+  ASSERT_EQ(BodyHash("\r\n \r\n\t\r\n"),
+            "47DEQpj8HBSa+/TImW+5JCeuQeRkm5NMpJWZG3hSuFU=");
+}
+
+TEST(DkimBodyHashTest, IndependentOfChunking) {
+  const std::string body = "a \t b\r\n\r c  \r\n\r\n\r\n";
+  const std::string expected = BodyHash(body);
+  ASSERT_EQ(expected, "AERT8zw2HhjV0ZK20bCE5YqtvsPMt1n5/wih08EiWqE=");
+  for (size_t i = 0; i <= body.size(); i++) {
+    for (size_t j = i; j <= body.size(); j++) {
+      DkimBodyHash body_hash;
+      body_hash.Update(absl::string_view(body).substr(0, i));
+      body_hash.Update(absl::string_view(body).substr(i, j - i));
+      body_hash.Update(absl::string_view(body).substr(j));
+      ASSERT_EQ(body_hash.Final(), expected) << i << ", " << j;
+    }
+  }
+}
+
+TEST(DkimTest, CanonicalizeHeaderRelaxed) {
+  ASSERT_EQ(CanonicalizeHeaderRelaxed("SubJect :  Hello \r\n\tWorld  "),
+            "subject:Hello World");
+  ASSERT_EQ(CanonicalizeHeaderRelaxed("To:"), "to:");
+}
+
+TEST(DkimSignerTest, SignsWithEd25519) {
+  const std::string key = GenerateKey(EVP_PKEY_ED25519);
+  DkimSigner signer;
+  ASSERT_TRUE(signer.AddKey("Example.com", "mail", key).ok());
+
+  auto header = signer.Sign("example.com", kHeaders, BodyHash("Body"));
+
+  ASSERT_TRUE(header.ok());
+  ASSERT_EQ(header->find("DKIM-Signature: v=1; a=ed25519-sha256; "
+                         "c=relaxed/relaxed; d=example.com; s=mail;"),
+            0);
+  ASSERT_NE(header->find("h=from:to:subject;"), std::string::npos);
+  ASSERT_TRUE(Verify(*header, kSignedFields, key, /* ed25519= */ true));
+}
+
+TEST(DkimSignerTest, SignsWithRsa) {
+  const std::string key = GenerateKey(EVP_PKEY_RSA);
+  DkimSigner signer;
+  ASSERT_TRUE(signer.AddKey("example.com", "mail", key).ok());
+
+  auto header = signer.Sign("example.com", kHeaders, BodyHash("Body"));
+
+  ASSERT_TRUE(header.ok());
+  ASSERT_EQ(header->find("DKIM-Signature: v=1; a=rsa-sha256;"), 0);
+  ASSERT_TRUE(Verify(*header, kSignedFields, key, /* ed25519= */ false));
+}
+
+TEST(DkimSignerTest, AddKeyReplacesKeyForDomain) {
+  DkimSigner signer;
+  ASSERT_TRUE(
+      signer.AddKey("example.com", "old", GenerateKey(EVP_PKEY_ED25519)).ok());
+  ASSERT_TRUE(
+      signer.AddKey("example.com", "new", GenerateKey(EVP_PKEY_ED25519)).ok());
+
+  auto header = signer.Sign("example.com", kHeaders, BodyHash("Body"));
+
+  ASSERT_TRUE(header.ok());
+  ASSERT_NE(header->find("s=new;"), std::string::npos);
+  ASSERT_TRUE(absl::IsNotFound(
+      signer.Sign("example.org", kHeaders, BodyHash("Body")).status()));
+}
+
+TEST(DkimSignerTest, DomainsMayShareSelector) {
+  const std::string com_key = GenerateKey(EVP_PKEY_ED25519);
+  const std::string org_key = GenerateKey(EVP_PKEY_ED25519);
+  DkimSigner signer;
+  ASSERT_TRUE(signer.AddKey("example.com", "default", com_key).ok());
+  ASSERT_TRUE(signer.AddKey("example.org", "default", org_key).ok());
+
+  auto com_header = signer.Sign("example.com", kHeaders, BodyHash("Body"));
+  auto org_header = signer.Sign("example.org", kHeaders, BodyHash("Body"));
+
+  ASSERT_TRUE(signer.HasKey("example.com"));
+  ASSERT_TRUE(signer.HasKey("example.org"));
+  ASSERT_TRUE(com_header.ok());
+  ASSERT_TRUE(org_header.ok());
+  ASSERT_NE(com_header->find("d=example.com; s=default;"), std::string::npos);
+  ASSERT_NE(org_header->find("d=example.org; s=default;"), std::string::npos);
+  ASSERT_TRUE(
+      Verify(*com_header, kSignedFields, com_key, /* ed25519= */ true));
+  ASSERT_TRUE(
+      Verify(*org_header, kSignedFields, org_key, /* ed25519= */ true));
+}
+
+TEST(DkimSignerTest, RejectsInvalidKey) {
+  DkimSigner signer;
+  ASSERT_TRUE(absl::IsInvalidArgument(
+      signer.AddKey("example.com", "mail", "not a key")));
+  ASSERT_FALSE(signer.HasKey("example.com"));
+}
+
+} // namespace
+} // namespace smtp
+} // namespace ez
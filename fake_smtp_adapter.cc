@@ -0,0 +1,95 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fake_smtp_adapter.h"
+
+#include <thread>
+
+namespace ez {
+namespace smtp {
+
+void Gate::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  blocked_++;
+  condition_.notify_all();
+  condition_.wait(lock, [this] { return open_; });
+}
+
+void Gate::WaitForBlocked(int count) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait(lock, [&] { return blocked_ >= count; });
+}
+
+void Gate::Open() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  open_ = true;
+  condition_.notify_all();
+}
+
+absl::Status FakeSmtpAdapter::Read(int) {
+  if (latency_.count() > 0) {
+    std::this_thread::sleep_for(latency_);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status FakeSmtpAdapter::WriteLine(absl::string_view message) {
+  if (gate_ != nullptr &&
+      message.find("Subject: block\r\n") != absl::string_view::npos) {
+    gate_->Wait();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status RefusingSmtpAdapter::Connect() {
+  connected_ = true;
+  connections_++;
+  return absl::OkStatus();
+}
+
+absl::Status RefusingSmtpAdapter::Read(int expected_return) {
+  if (!connected_) {
+    (*misuses_)++;
+    return absl::FailedPreconditionError("Not connected");
+  }
+  if (expected_return == 220 && connections_ > 1) {
+    return absl::UnavailableError("The server is shutting down (421)");
+  }
+  if (last_command_ == "MAIL") {
+    return absl::UnavailableError("The server closed the connection");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status RefusingSmtpAdapter::WriteLine(absl::string_view message) {
+  if (!connected_) {
+    (*misuses_)++;
+    return absl::FailedPreconditionError("Not connected");
+  }
+  last_command_ = std::string(message.substr(0, 4));
+  return absl::OkStatus();
+}
+
+Email NewTestEmail(absl::string_view subject, std::string body) {
+  Email email;
+  email.sender.address = "from@example.com";
+  Recipient &recipient = email.recipients.emplace_back();
+  recipient.address = "to@example.com";
+  email.subject = std::string(subject);
+  email.body = std::move(body);
+  return email;
+}
+
+} // namespace smtp
+} // namespace ez
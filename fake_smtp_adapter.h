@@ -0,0 +1,101 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_FAKE_SMTP_ADAPTER_H
+#define EZ_FAKE_SMTP_ADAPTER_H
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "smtp.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+namespace ez {
+namespace smtp {
+
+/** Holds sends of emails whose subject is "block" until opened. */
+class Gate {
+public:
+  /** Blocks until the gate is opened. */
+  void Wait();
+
+  /** Blocks until the given number of sends are waiting, or have waited, at
+   * the gate. */
+  void WaitForBlocked(int count);
+
+  void Open();
+
+private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  int blocked_ = 0;
+  bool open_ = false;
+};
+
+/** An in-memory server for tests and load generators of the senders. It
+ * accepts every command, optionally sleeping before each reply to simulate a
+ * remote server, and waits at the gate, if any, while writing an email whose
+ * subject is "block". */
+class FakeSmtpAdapter : public SmtpAdapter {
+public:
+  explicit FakeSmtpAdapter(Gate *gate = nullptr) : gate_(gate) {}
+  explicit FakeSmtpAdapter(std::chrono::microseconds latency)
+      : latency_(latency) {}
+
+  absl::Status Connect() override { return absl::OkStatus(); }
+  absl::Status EnableTls() override { return absl::OkStatus(); }
+  absl::Status Read(int) override;
+  absl::Status WriteLine(absl::string_view message) override;
+  std::string Hostname() override { return "TestHost"; }
+  void Disconnect() override {}
+  void EnableLogging() override {}
+
+private:
+  Gate *gate_ = nullptr;
+  std::chrono::microseconds latency_{0};
+};
+
+/** Drops the first connection after MAIL FROM and refuses every later one
+ * with 421, like a server over its connection limit. Counts commands sent
+ * while disconnected, which SmtpAdapterImpl cannot do. */
+class RefusingSmtpAdapter : public SmtpAdapter {
+public:
+  explicit RefusingSmtpAdapter(std::atomic<int> *misuses)
+      : misuses_(misuses) {}
+
+  absl::Status Connect() override;
+  absl::Status EnableTls() override { return absl::OkStatus(); }
+  absl::Status Read(int expected_return) override;
+  absl::Status WriteLine(absl::string_view message) override;
+  std::string Hostname() override { return "TestHost"; }
+  void Disconnect() override { connected_ = false; }
+  void EnableLogging() override {}
+
+private:
+  std::atomic<int> *misuses_;
+  bool connected_ = false;
+  int connections_ = 0;
+  std::string last_command_;
+};
+
+/** Returns an email from and to example.com with the given subject. */
+Email NewTestEmail(absl::string_view subject, std::string body = "Body");
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_FAKE_SMTP_ADAPTER_H
@@ -0,0 +1,230 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fake_smtp_server.h"
+
+#include "absl/strings/str_cat.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <csignal>
+#include <cstring>
+#include <netinet/in.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ez {
+namespace smtp {
+namespace {
+
+// Configures the context with a new self-signed P-256 certificate.
+bool UseSelfSignedCertificate(SSL_CTX *context) {
+  std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX *)> key_context(
+      EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr), EVP_PKEY_CTX_free);
+  EVP_PKEY *key = nullptr;
+  if (EVP_PKEY_keygen_init(key_context.get()) <= 0 ||
+      EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_context.get(),
+                                             NID_X9_62_prime256v1) <= 0 ||
+      EVP_PKEY_keygen(key_context.get(), &key) <= 0) {
+    return false;
+  }
+  std::unique_ptr<EVP_PKEY, void (*)(EVP_PKEY *)> free_key(key, EVP_PKEY_free);
+  std::unique_ptr<X509, void (*)(X509 *)> certificate(X509_new(), X509_free);
+  X509_set_version(certificate.get(), 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(certificate.get()), 1);
+  X509_gmtime_adj(X509_getm_notBefore(certificate.get()), 0);
+  X509_gmtime_adj(X509_getm_notAfter(certificate.get()), 24 * 60 * 60);
+  X509_NAME *name = X509_get_subject_name(certificate.get());
+  X509_NAME_add_entry_by_txt(
+      name, "CN", MBSTRING_ASC,
+      reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+  X509_set_issuer_name(certificate.get(), name);
+  X509_set_pubkey(certificate.get(), key);
+  return X509_sign(certificate.get(), key, EVP_sha256()) > 0 &&
+         SSL_CTX_use_certificate(context, certificate.get()) == 1 &&
+         SSL_CTX_use_PrivateKey(context, key) == 1;
+}
+
+} // namespace
+
+/** One client connection, reading lines in plaintext or over tls. */
+class FakeSmtpServer::Connection {
+public:
+  explicit Connection(int socket) : socket_(socket), ssl_(nullptr) {}
+
+  ~Connection() {
+    if (ssl_ != nullptr) {
+      SSL_free(ssl_);
+    }
+  }
+
+  bool StartTls(SSL_CTX *context) {
+    ssl_ = SSL_new(context);
+    SSL_set_fd(ssl_, socket_);
+    return SSL_accept(ssl_) == 1;
+  }
+
+  bool ReadLine(std::string *line) {
+    size_t end;
+    while ((end = buffer_.find("\r\n")) == std::string::npos) {
+      char data[4096];
+      int size = ssl_ != nullptr ? SSL_read(ssl_, data, sizeof(data))
+                                 : recv(socket_, data, sizeof(data), 0);
+      if (size <= 0) {
+        return false;
+      }
+      buffer_.append(data, size);
+    }
+    line->assign(buffer_, 0, end);
+    buffer_.erase(0, end + 2);
+    return true;
+  }
+
+  bool Write(absl::string_view reply) {
+    const std::string line = absl::StrCat(reply, "\r\n");
+    if (ssl_ != nullptr) {
+      return SSL_write(ssl_, line.data(), line.size()) ==
+             static_cast<int>(line.size());
+    }
+    return send(socket_, line.data(), line.size(), MSG_NOSIGNAL) ==
+           static_cast<ssize_t>(line.size());
+  }
+
+private:
+  int socket_;
+  SSL *ssl_;
+  std::string buffer_;
+};
+
+FakeSmtpServer::FakeSmtpServer(TlsMode tls_mode)
+    : tls_mode_(tls_mode),
+      ssl_context_(SSL_CTX_new(TLS_server_method()), SSL_CTX_free),
+      listen_socket_(-1), stopped_(false) {}
+
+FakeSmtpServer::~FakeSmtpServer() {
+  Stop();
+  if (listen_socket_ >= 0) {
+    close(listen_socket_);
+  }
+}
+
+absl::StatusOr<int> FakeSmtpServer::Listen() {
+  if (!UseSelfSignedCertificate(ssl_context_.get())) {
+    return absl::InternalError("Unable to create a certificate");
+  }
+  listen_socket_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t size = sizeof(address);
+  if (listen_socket_ < 0 ||
+      bind(listen_socket_, reinterpret_cast<sockaddr *>(&address), size) < 0 ||
+      listen(listen_socket_, SOMAXCONN) < 0 ||
+      getsockname(listen_socket_, reinterpret_cast<sockaddr *>(&address),
+                  &size) < 0) {
+    return absl::UnavailableError(strerror(errno));
+  }
+  return ntohs(address.sin_port);
+}
+
+void FakeSmtpServer::Serve() {
+  while (true) {
+    int socket = accept4(listen_socket_, nullptr, nullptr, SOCK_CLOEXEC);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) {
+      if (socket >= 0) {
+        close(socket);
+      }
+      return;
+    }
+    if (socket < 0) {
+      continue;
+    }
+    sockets_.push_back(socket);
+    threads_.emplace_back([this, socket] { ServeConnection(socket); });
+  }
+}
+
+void FakeSmtpServer::Stop() {
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) {
+      return;
+    }
+    stopped_ = true;
+    if (listen_socket_ >= 0) {
+      shutdown(listen_socket_, SHUT_RDWR);
+    }
+    for (int socket : sockets_) {
+      shutdown(socket, SHUT_RDWR);
+    }
+    threads.swap(threads_);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+std::vector<std::string> FakeSmtpServer::messages() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return messages_;
+}
+
+void FakeSmtpServer::ServeConnection(int socket) {
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  Connection connection(socket);
+  bool ok = tls_mode_ == StartTls || connection.StartTls(ssl_context_.get());
+  ok = ok && connection.Write("220 localhost ESMTP");
+  std::string line;
+  while (ok && connection.ReadLine(&line)) {
+    const std::string command = line.substr(0, 4);
+    if (command == "STAR") {
+      ok = connection.Write("220 Ready to start TLS") &&
+           connection.StartTls(ssl_context_.get());
+    } else if (command == "AUTH") {
+      ok = connection.Write("334 ") && connection.ReadLine(&line) &&
+           connection.Write("235 Authenticated");
+    } else if (command == "DATA") {
+      ok = connection.Write("354 Go ahead");
+      std::string message;
+      while (ok && (ok = connection.ReadLine(&line)) && line != ".") {
+        absl::StrAppend(&message, line, "\r\n");
+      }
+      if (ok && record_messages_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        messages_.push_back(std::move(message));
+      }
+      ok = ok && connection.Write("250 Queued");
+    } else if (command == "QUIT") {
+      connection.Write("221 Bye");
+      break;
+    } else {
+      // HELO, MAIL, RCPT and NOOP.
+      ok = connection.Write("250 OK");
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  close(socket);
+  sockets_.erase(std::find(sockets_.begin(), sockets_.end(), socket));
+}
+
+} // namespace smtp
+} // namespace ez
@@ -0,0 +1,89 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_FAKE_SMTP_SERVER_H
+#define EZ_FAKE_SMTP_SERVER_H
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "smtp.h"
+#include <memory>
+#include <mutex>
+#include <openssl/ssl.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ez {
+namespace smtp {
+
+/** A minimal SMTP server on the loopback interface for tests and benchmarks
+ * of real transports. It accepts any credentials, supports STARTTLS or
+ * implicit tls with a self-signed certificate, and records the data of each
+ * message it receives.
+ *
+ * Example:
+ *
+ *   FakeSmtpServer server;
+ *   auto port = server.Listen();
+ *   std::thread thread([&server] { server.Serve(); });
+ *   ... send email to 127.0.0.1:*port ...
+ *   server.Stop();
+ *   thread.join();
+ */
+class FakeSmtpServer {
+public:
+  explicit FakeSmtpServer(TlsMode tls_mode = StartTls);
+  ~FakeSmtpServer();
+
+  /** Listens on an ephemeral loopback port, returning the port. */
+  absl::StatusOr<int> Listen();
+
+  /** Accepts connections until Stop is called, serving each on its own
+   * thread. */
+  void Serve();
+
+  /** Stops accepting connections and closes open connections. */
+  void Stop();
+
+  /** Returns the data of each message received, without the terminating
+   * ".". */
+  std::vector<std::string> messages();
+
+  /** Sets whether to keep the data of messages received, which tests sending
+   * a lot of data may turn off. Call before Serve. Defaults to true. */
+  void set_record_messages(bool record_messages) {
+    record_messages_ = record_messages;
+  }
+
+private:
+  class Connection;
+
+  void ServeConnection(int socket);
+
+  const TlsMode tls_mode_;
+  std::unique_ptr<SSL_CTX, void (*)(SSL_CTX *)> ssl_context_;
+  int listen_socket_;
+  std::mutex mutex_;
+  bool stopped_;
+  bool record_messages_ = true;
+  std::vector<int> sockets_;
+  std::vector<std::thread> threads_;
+  std::vector<std::string> messages_;
+};
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_FAKE_SMTP_SERVER_H
@@ -0,0 +1,724 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "io_uring_adapter.h"
+
+#include "absl/strings/str_cat.h"
+#include "status_macros.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netdb.h>
+#include <openssl/buffer.h>
+#include <openssl/err.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#define EZ_HAVE_IO_URING 1
+#endif
+
+namespace ez {
+namespace smtp {
+namespace {
+
+// Fits within the default 64 KB RLIMIT_MEMLOCK on kernels that charge
+// registered buffers to it.
+constexpr size_t kReadBufferSize = 16 << 10;
+
+// Queued output is written once it reaches this size, rather than waiting
+// for the next read.
+constexpr size_t kMaxOutputSize = 64 << 10;
+
+// Queued output capacity kept between commands. Larger buffers, e.g. for
+// message data, are freed so that idle sessions stay small.
+constexpr size_t kIdleOutputCapacity = 1 << 10;
+
+// Plaintext passed to SSL_write at a time, bounding the memory BIO.
+constexpr size_t kMaxTlsWrite = 16 << 10;
+
+// Lines up to this size are queued together with their CRLF, and encrypted as
+// one tls record. Longer lines, i.e. message data, are written from the
+// caller's buffer, or encrypted into the thread's write buffer, so that the
+// line and output buffers stay small.
+constexpr size_t kMaxCoalescedLine = 1 << 10;
+
+std::string ErrnoMessage(int error) { return std::strerror(error); }
+
+std::string TlsErrorMessage(absl::string_view context) {
+  unsigned long error = ERR_get_error();
+  ERR_clear_error();
+  if (error == 0) {
+    return std::string(context);
+  }
+  char message[256];
+  ERR_error_string_n(error, message, sizeof(message));
+  return absl::StrCat(context, ": ", message);
+}
+
+std::string AddressToString(const sockaddr *address) {
+  char result[INET6_ADDRSTRLEN] = "";
+  if (address->sa_family == AF_INET) {
+    inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in *>(address)->sin_addr,
+              result, sizeof(result));
+  } else if (address->sa_family == AF_INET6) {
+    inet_ntop(AF_INET6,
+              &reinterpret_cast<const sockaddr_in6 *>(address)->sin6_addr,
+              result, sizeof(result));
+  }
+  return result;
+}
+
+} // namespace
+
+#ifdef EZ_HAVE_IO_URING
+
+/** A minimal io_uring used by a single thread, owning the buffer that replies
+ * are read into and the buffer that message data is encrypted into.
+ * Operations are queued and then submitted together, and none are in flight
+ * between submissions. The read buffer is registered with the ring. Writes
+ * are sends rather than fixed buffer writes, as only a send can pass
+ * MSG_NOSIGNAL to avoid SIGPIPE. */
+class IoUringSmtpAdapter::Ring {
+public:
+  // Identifies an operation in its completion. At most one of each may be
+  // queued at a time.
+  enum Operation { kConnect = 0, kWrite = 1, kRead = 2, kOperations = 3 };
+
+  Ring()
+      : fd_(-1), sq_ring_(MAP_FAILED), cq_ring_(MAP_FAILED),
+        sqes_(static_cast<io_uring_sqe *>(MAP_FAILED)), queued_(0),
+        fixed_buffers_(false), broken_(false),
+        read_buffer_(new char[kReadBufferSize]) {}
+
+  ~Ring() {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  absl::Status Init() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    // Completions are only ever reaped by the submitting thread while it
+    // waits, so the kernel can defer its work until then rather than
+    // interrupting the thread (Linux 6.1 and later).
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    fd_ = syscall(__NR_io_uring_setup, kEntries, &params);
+    if (fd_ < 0 && errno == EINVAL) {
+      memset(&params, 0, sizeof(params));
+      fd_ = syscall(__NR_io_uring_setup, kEntries, &params);
+    }
+    if (fd_ < 0) {
+      return absl::UnavailableError(
+          absl::StrCat("io_uring_setup: ", ErrnoMessage(errno)));
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      return absl::UnavailableError(ErrnoMessage(errno));
+    }
+    cq_ring_ = single_mmap
+                   ? sq_ring_
+                   : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      return absl::UnavailableError(ErrnoMessage(errno));
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(
+        mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+      return absl::UnavailableError(ErrnoMessage(errno));
+    }
+
+    char *sq = static_cast<char *>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    RETURN_IF_ERROR(CheckOperations());
+
+    iovec buffer = {read_buffer_.get(), kReadBufferSize};
+    // Registering can fail where the buffer exceeds RLIMIT_MEMLOCK, in which
+    // case it is passed with each read instead.
+    fixed_buffers_ = syscall(__NR_io_uring_register, fd_,
+                             IORING_REGISTER_BUFFERS, &buffer, 1) == 0;
+    return absl::OkStatus();
+  }
+
+  char *read_buffer() { return read_buffer_.get(); }
+
+  // Ciphertext of message data waiting to be written. It is only used within
+  // a WriteLine, and holds at most kMaxOutputSize plus one tls record, so its
+  // capacity is kept.
+  std::string &write_buffer() { return write_buffer_; }
+
+  // Returns whether a submission failed, possibly leaving operations in
+  // flight, after which the ring must not be used.
+  bool broken() const { return broken_; }
+
+  void QueueConnect(int socket, const sockaddr *address, socklen_t size) {
+    io_uring_sqe *entry = NextEntry(IORING_OP_CONNECT, socket, kConnect);
+    entry->addr = reinterpret_cast<uint64_t>(address);
+    entry->off = size;
+  }
+
+  // Queues a write of the data, which must remain valid until submitted. If
+  // link is true, the next queued operation is cancelled unless the write
+  // completes in full.
+  void QueueWrite(int socket, absl::string_view data, bool link) {
+    io_uring_sqe *entry = NextEntry(IORING_OP_SEND, socket, kWrite);
+    entry->addr = reinterpret_cast<uint64_t>(data.data());
+    entry->len = data.size();
+    entry->msg_flags = MSG_NOSIGNAL;
+    if (link) {
+      entry->flags |= IOSQE_IO_LINK;
+    }
+  }
+
+  // Queues a read into the read buffer.
+  void QueueRead(int socket) {
+    io_uring_sqe *entry = NextEntry(
+        fixed_buffers_ ? IORING_OP_READ_FIXED : IORING_OP_READ, socket, kRead);
+    entry->addr = reinterpret_cast<uint64_t>(read_buffer_.get());
+    entry->len = kReadBufferSize;
+    entry->buf_index = 0;
+  }
+
+  // Submits the queued operations and waits for all of them to complete,
+  // storing the result of each by its Operation.
+  absl::Status Submit(int results[kOperations]) {
+    unsigned tail = *sq_tail_;
+    __atomic_store_n(sq_tail_, tail + queued_, __ATOMIC_RELEASE);
+    unsigned to_submit = queued_;
+    unsigned remaining = queued_;
+    queued_ = 0;
+    while (remaining > 0) {
+      int submitted = syscall(__NR_io_uring_enter, fd_, to_submit, remaining,
+                              IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (submitted < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        broken_ = true;
+        return absl::UnavailableError(
+            absl::StrCat("io_uring_enter: ", ErrnoMessage(errno)));
+      }
+      to_submit -= std::min<unsigned>(submitted, to_submit);
+      unsigned head = *cq_head_;
+      const unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      for (; head != cq_tail; head++) {
+        const io_uring_cqe &completion = cqes_[head & cq_mask_];
+        results[completion.user_data] = completion.res;
+        remaining--;
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+    return absl::OkStatus();
+  }
+
+private:
+  static constexpr unsigned kEntries = 4;
+
+  // Checks that the kernel supports every opcode that may be queued.
+  absl::Status CheckOperations() {
+    constexpr int kProbeOperations = 64;
+    std::unique_ptr<char[]> buffer(
+        new char[sizeof(io_uring_probe) +
+                 kProbeOperations * sizeof(io_uring_probe_op)]());
+    io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(buffer.get());
+    if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe,
+                kProbeOperations) < 0) {
+      return absl::UnavailableError(
+          absl::StrCat("io_uring probe: ", ErrnoMessage(errno)));
+    }
+    for (int opcode : {IORING_OP_CONNECT, IORING_OP_SEND, IORING_OP_READ,
+                       IORING_OP_READ_FIXED}) {
+      if (opcode > probe->last_op ||
+          !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+        return absl::UnavailableError(
+            absl::StrCat("io_uring opcode ", opcode, " is not supported"));
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  io_uring_sqe *NextEntry(uint8_t opcode, int fd, Operation operation) {
+    const unsigned index = (*sq_tail_ + queued_) & sq_mask_;
+    io_uring_sqe *entry = &sqes_[index];
+    memset(entry, 0, sizeof(*entry));
+    entry->opcode = opcode;
+    entry->fd = fd;
+    entry->user_data = operation;
+    sq_array_[index] = index;
+    queued_++;
+    return entry;
+  }
+
+  int fd_;
+  void *sq_ring_;
+  size_t sq_ring_size_;
+  void *cq_ring_;
+  size_t cq_ring_size_;
+  io_uring_sqe *sqes_;
+  size_t sqes_size_;
+  unsigned *sq_tail_;
+  unsigned sq_mask_;
+  unsigned *sq_array_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned cq_mask_;
+  io_uring_cqe *cqes_;
+  unsigned queued_;
+  bool fixed_buffers_;
+  bool broken_;
+  std::unique_ptr<char[]> read_buffer_;
+  std::string write_buffer_;
+};
+
+#else
+
+/** Stands in for the io_uring where it is not available, failing Init. */
+class IoUringSmtpAdapter::Ring {
+public:
+  enum Operation { kConnect = 0, kWrite = 1, kRead = 2, kOperations = 3 };
+
+  absl::Status Init() {
+    return absl::UnimplementedError("io_uring requires Linux");
+  }
+  char *read_buffer() { return nullptr; }
+  std::string &write_buffer() { return write_buffer_; }
+  bool broken() const { return true; }
+  void QueueConnect(int socket, const sockaddr *address, socklen_t size) {}
+  void QueueWrite(int socket, absl::string_view data, bool link) {}
+  void QueueRead(int socket) {}
+  absl::Status Submit(int results[kOperations]) {
+    return absl::UnimplementedError("io_uring requires Linux");
+  }
+
+private:
+  std::string write_buffer_;
+};
+
+#endif // EZ_HAVE_IO_URING
+
+IoUringSmtpAdapter::IoUringSmtpAdapter(absl::string_view hostname,
+                                       const int port, TlsMode tls_mode,
+                                       std::shared_ptr<SmtpContext> context)
+    : hostname_(std::string(hostname)), port_(port), tls_mode_(tls_mode),
+      socket_(-1), context_(std::move(context)), ssl_(nullptr),
+      network_input_(nullptr), network_output_(nullptr), log_(false) {}
+
+IoUringSmtpAdapter::~IoUringSmtpAdapter() { Disconnect(); }
+
+bool IoUringSmtpAdapter::IsSupported() {
+  static const bool supported = Ring().Init().ok();
+  return supported;
+}
+
+absl::StatusOr<IoUringSmtpAdapter::Ring *> IoUringSmtpAdapter::ThreadRing() {
+  thread_local std::unique_ptr<Ring> thread_ring;
+  if (thread_ring == nullptr || thread_ring->broken()) {
+    auto ring = std::make_unique<Ring>();
+    RETURN_IF_ERROR(ring->Init());
+    thread_ring = std::move(ring);
+  }
+  return thread_ring.get();
+}
+
+absl::Status IoUringSmtpAdapter::Connect() {
+  Disconnect();
+  auto ring = ThreadRing();
+  if (!ring.ok()) {
+    return ring.status();
+  }
+
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *addresses = nullptr;
+  int error = getaddrinfo(hostname_.c_str(), std::to_string(port_).c_str(),
+                          &hints, &addresses);
+  if (error != 0) {
+    return absl::UnavailableError(gai_strerror(error));
+  }
+  std::unique_ptr<addrinfo, void (*)(addrinfo *)> free_addresses(
+      addresses, freeaddrinfo);
+
+  absl::Status status = absl::UnavailableError(
+      absl::StrCat("No address found for ", hostname_));
+  for (addrinfo *address = addresses; address != nullptr;
+       address = address->ai_next) {
+    int socket = ::socket(address->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket < 0) {
+      status = absl::UnavailableError(ErrnoMessage(errno));
+      continue;
+    }
+    (*ring)->QueueConnect(socket, address->ai_addr, address->ai_addrlen);
+    int results[Ring::kOperations] = {};
+    status = (*ring)->Submit(results);
+    if (status.ok() && results[Ring::kConnect] < 0) {
+      status = absl::UnavailableError(ErrnoMessage(-results[Ring::kConnect]));
+    }
+    if (status.ok()) {
+      socket_ = socket;
+      address_ = AddressToString(address->ai_addr);
+      break;
+    }
+    close(socket);
+  }
+  RETURN_IF_ERROR(status);
+
+  if (tls_mode_ == ImplicitTls) {
+    status = EnableTls();
+    if (!status.ok()) {
+      Disconnect();
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status IoUringSmtpAdapter::EnableTls() {
+  if (socket_ < 0) {
+    return absl::FailedPreconditionError("Not connected");
+  }
+  if (ssl_ != nullptr) {
+    SSL_free(ssl_);
+    network_input_ = nullptr;
+    network_output_ = nullptr;
+  }
+  ssl_ = SSL_new(context_->ssl_context().native_handle());
+  if (ssl_ == nullptr) {
+    return absl::InternalError(TlsErrorMessage("Tls setup failed"));
+  }
+  BIO *network_input = BIO_new(BIO_s_mem());
+  BIO *network_output = BIO_new(BIO_s_mem());
+  if (network_input == nullptr || network_output == nullptr) {
+    BIO_free(network_input);
+    BIO_free(network_output);
+    SSL_free(ssl_);
+    ssl_ = nullptr;
+    return absl::InternalError(TlsErrorMessage("Tls setup failed"));
+  }
+  network_input_ = network_input;
+  network_output_ = network_output;
+  SSL_set_bio(ssl_, network_input_, network_output_);
+  SSL_set_connect_state(ssl_);
+  while (true) {
+    int result = SSL_do_handshake(ssl_);
+    RETURN_IF_ERROR(QueueTlsOutput());
+    if (result == 1) {
+      // Sending the last flight of the handshake with the first command would
+      // save a syscall, but the server's reply to the command could then be
+      // held back by Nagle's algorithm behind its session tickets until the
+      // client's delayed ACK.
+      auto flushed = Exchange(/* read= */ false);
+      return flushed.ok() ? absl::OkStatus() : flushed.status();
+    }
+    if (SSL_get_error(ssl_, result) != SSL_ERROR_WANT_READ) {
+      return absl::InternalError(TlsErrorMessage("Tls handshake failed"));
+    }
+    RETURN_IF_ERROR(ReadTlsInput());
+  }
+}
+
+absl::Status IoUringSmtpAdapter::Read(const int expected_return) {
+  if (socket_ < 0) {
+    return absl::FailedPreconditionError("Not connected");
+  }
+  reply_.clear();
+  if (ssl_ == nullptr) {
+    auto input = Exchange(/* read= */ true);
+    if (!input.ok()) {
+      return input.status();
+    }
+    reply_.assign(input->data(), input->size());
+  } else {
+    char buffer[1024];
+    while (true) {
+      int size = SSL_read(ssl_, buffer, sizeof(buffer));
+      if (size > 0) {
+        reply_.assign(buffer, size);
+        break;
+      }
+      int error = SSL_get_error(ssl_, size);
+      if (error == SSL_ERROR_ZERO_RETURN) {
+        return absl::UnavailableError("The server closed the connection");
+      }
+      if (error != SSL_ERROR_WANT_READ) {
+        return absl::UnavailableError(TlsErrorMessage("Tls read failed"));
+      }
+      RETURN_IF_ERROR(QueueTlsOutput());
+      RETURN_IF_ERROR(ReadTlsInput());
+    }
+  }
+  if (log_) {
+    std::cout << reply_;
+  }
+  return CheckReply(reply_, expected_return);
+}
+
+absl::Status IoUringSmtpAdapter::WriteLine(absl::string_view message) {
+  if (socket_ < 0) {
+    return absl::FailedPreconditionError("Not connected");
+  }
+  if (log_) {
+    std::cout << message << "\r\n";
+  }
+  if (message.size() + 2 > kMaxCoalescedLine) {
+    return WriteData(message);
+  }
+  if (ssl_ == nullptr) {
+    RETURN_IF_ERROR(Queue(message));
+    return Queue("\r\n");
+  }
+  line_.assign(message.data(), message.size());
+  line_.append("\r\n");
+  return WriteTls(line_);
+}
+
+absl::Status IoUringSmtpAdapter::WriteTls(absl::string_view data) {
+  absl::string_view remaining = data;
+  while (!remaining.empty()) {
+    int written = SSL_write(ssl_, remaining.data(),
+                            std::min(remaining.size(), kMaxTlsWrite));
+    if (written <= 0) {
+      return absl::UnavailableError(TlsErrorMessage("Tls write failed"));
+    }
+    remaining.remove_prefix(written);
+    RETURN_IF_ERROR(QueueTlsOutput());
+  }
+  return absl::OkStatus();
+}
+
+absl::Status IoUringSmtpAdapter::WriteData(absl::string_view message) {
+  auto flushed = Exchange(/* read= */ false);
+  if (!flushed.ok()) {
+    return flushed.status();
+  }
+  if (ssl_ == nullptr) {
+    flushed = Transfer(message, /* read= */ false);
+    if (!flushed.ok()) {
+      return flushed.status();
+    }
+    return Queue("\r\n");
+  }
+  auto ring = ThreadRing();
+  if (!ring.ok()) {
+    return ring.status();
+  }
+  std::string &ciphertext = (*ring)->write_buffer();
+  ciphertext.clear();
+  absl::string_view remaining = message;
+  while (!remaining.empty()) {
+    int written = SSL_write(ssl_, remaining.data(),
+                            std::min(remaining.size(), kMaxTlsWrite));
+    if (written <= 0) {
+      return absl::UnavailableError(TlsErrorMessage("Tls write failed"));
+    }
+    remaining.remove_prefix(written);
+    ReadTlsOutput(&ciphertext);
+    if (ciphertext.size() >= kMaxOutputSize || remaining.empty()) {
+      flushed = Transfer(ciphertext, /* read= */ false);
+      ciphertext.clear();
+      if (!flushed.ok()) {
+        return flushed.status();
+      }
+    }
+  }
+  ReleaseTlsOutput();
+  return WriteTls("\r\n");
+}
+
+void IoUringSmtpAdapter::Disconnect() {
+  if (ssl_ != nullptr) {
+    SSL_free(ssl_);
+    ssl_ = nullptr;
+    network_input_ = nullptr;
+    network_output_ = nullptr;
+  }
+  if (socket_ >= 0) {
+    close(socket_);
+    socket_ = -1;
+  }
+  ClearOutput();
+}
+
+absl::Status IoUringSmtpAdapter::Queue(absl::string_view data) {
+  output_.append(data.data(), data.size());
+  if (output_.size() >= kMaxOutputSize) {
+    auto flushed = Exchange(/* read= */ false);
+    if (!flushed.ok()) {
+      return flushed.status();
+    }
+  }
+  return absl::OkStatus();
+}
+
+void IoUringSmtpAdapter::ReadTlsOutput(std::string *output) {
+  const size_t pending = BIO_ctrl_pending(network_output_);
+  if (pending == 0) {
+    return;
+  }
+  const size_t offset = output->size();
+  output->resize(offset + pending);
+  int size = BIO_read(network_output_, &(*output)[offset], pending);
+  output->resize(offset + std::max(size, 0));
+}
+
+absl::Status IoUringSmtpAdapter::QueueTlsOutput() {
+  ReadTlsOutput(&output_);
+  if (output_.size() >= kMaxOutputSize) {
+    auto flushed = Exchange(/* read= */ false);
+    if (!flushed.ok()) {
+      return flushed.status();
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status IoUringSmtpAdapter::ReadTlsInput() {
+  auto input = Exchange(/* read= */ true);
+  if (!input.ok()) {
+    return input.status();
+  }
+  BIO_write(network_input_, input->data(), input->size());
+  return absl::OkStatus();
+}
+
+void IoUringSmtpAdapter::ReleaseTlsOutput() {
+  BUF_MEM *buffer = nullptr;
+  BIO_get_mem_ptr(network_output_, &buffer);
+  if (buffer == nullptr || buffer->max <= kIdleOutputCapacity) {
+    return;
+  }
+  BIO *network_output = BIO_new(BIO_s_mem());
+  if (network_output == nullptr) {
+    return;
+  }
+  // Frees the drained BIO.
+  SSL_set0_wbio(ssl_, network_output);
+  network_output_ = network_output;
+}
+
+void IoUringSmtpAdapter::ClearOutput() {
+  if (output_.capacity() > kIdleOutputCapacity) {
+    std::string().swap(output_);
+  } else {
+    output_.clear();
+  }
+}
+
+absl::StatusOr<absl::string_view> IoUringSmtpAdapter::Exchange(bool read) {
+  auto input = Transfer(output_, read);
+  ClearOutput();
+  return input;
+}
+
+absl::StatusOr<absl::string_view>
+IoUringSmtpAdapter::Transfer(absl::string_view data, bool read) {
+  auto ring = ThreadRing();
+  if (!ring.ok()) {
+    return ring.status();
+  }
+  size_t written = 0;
+  while (true) {
+    const bool writing = written < data.size();
+    if (!writing && !read) {
+      return absl::string_view();
+    }
+    if (writing) {
+      (*ring)->QueueWrite(socket_, data.substr(written), /* link= */ read);
+    }
+    if (read) {
+      (*ring)->QueueRead(socket_);
+    }
+    int results[Ring::kOperations] = {};
+    RETURN_IF_ERROR((*ring)->Submit(results));
+    if (writing) {
+      const int result = results[Ring::kWrite];
+      if (result <= 0) {
+        return absl::UnavailableError(
+            result == 0 ? "The server closed the connection"
+                        : ErrnoMessage(-result));
+      }
+      written += result;
+      // A short write cancels the linked read, so both are submitted again.
+      if (written < data.size()) {
+        continue;
+      }
+    }
+    if (!read) {
+      return absl::string_view();
+    }
+    const int result = results[Ring::kRead];
+    if (result == 0) {
+      return absl::UnavailableError("The server closed the connection");
+    }
+    if (result < 0) {
+      return absl::UnavailableError(ErrnoMessage(-result));
+    }
+    return absl::string_view((*ring)->read_buffer(), result);
+  }
+}
+
+std::shared_ptr<SmtpAdapter> NewSmtpAdapter(absl::string_view hostname,
+                                            const int port, TlsMode tls_mode,
+                                            Transport transport,
+                                            std::shared_ptr<SmtpContext> context) {
+  if (transport == IoUringTransport && IoUringSmtpAdapter::IsSupported()) {
+    return std::make_shared<IoUringSmtpAdapter>(hostname, port, tls_mode,
+                                                std::move(context));
+  }
+  return std::make_shared<SmtpAdapterImpl>(hostname, port, tls_mode,
+                                           std::move(context));
+}
+
+} // namespace smtp
+} // namespace ez
@@ -0,0 +1,144 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_IO_URING_ADAPTER_H
+#define EZ_IO_URING_ADAPTER_H
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "smtp.h"
+#include <memory>
+#include <openssl/ssl.h>
+
+namespace ez {
+namespace smtp {
+
+/** Socket I/O implementations that an SmtpAdapter may be created with. */
+enum Transport { AsioTransport = 0, IoUringTransport = 1 };
+
+/** SmtpAdapter that performs socket I/O through a Linux io_uring rather than
+ * Asio. A command is not written by WriteLine, but queued and submitted
+ * together with the read of its reply, so that a command and reply round trip
+ * takes a single io_uring_enter syscall. Adapters used on the same thread share
+ * one ring, and replies are read into a buffer registered with it, so an idle
+ * session holds little more than its socket and tls state. Tls is handled by
+ * OpenSSL over memory BIOs, so the ring only ever sees ciphertext.
+ *
+ * Since WriteLine only queues the command, a lost connection is reported by
+ * the following Read instead.
+ *
+ * Use NewSmtpAdapter to fall back to SmtpAdapterImpl where io_uring is not
+ * available.
+ */
+class IoUringSmtpAdapter : public SmtpAdapter {
+public:
+  IoUringSmtpAdapter(
+      absl::string_view hostname, int port, TlsMode tls_mode = StartTls,
+      std::shared_ptr<SmtpContext> context = SmtpContext::Default());
+  ~IoUringSmtpAdapter();
+
+  /** Returns whether the kernel supports the io_uring operations this adapter
+   * needs. io_uring may also be missing on older kernels or disabled by a
+   * sysctl or seccomp policy. */
+  static bool IsSupported();
+
+  absl::Status Connect() override;
+
+  absl::Status EnableTls() override;
+
+  absl::Status Read(int expected_return) override;
+
+  absl::Status WriteLine(absl::string_view message) override;
+
+  std::string Hostname() override { return address_; }
+
+  absl::string_view LastReply() override { return reply_; }
+
+  void Disconnect() override;
+
+  void EnableLogging() override { log_ = true; }
+
+private:
+  class Ring;
+
+  // Returns the calling thread's ring, creating it on first use or after a
+  // failed submission.
+  static absl::StatusOr<Ring *> ThreadRing();
+
+  // Queues data to be written by the next Exchange, flushing the output when
+  // it is large.
+  absl::Status Queue(absl::string_view data);
+
+  // Encrypts the data, queueing the ciphertext.
+  absl::Status WriteTls(absl::string_view data);
+
+  // Writes a long line, i.e. message data, after the queued data. The line is
+  // written from the caller's buffer, or encrypted into the thread's write
+  // buffer, rather than being queued. Its CRLF is queued.
+  absl::Status WriteData(absl::string_view message);
+
+  // Appends the ciphertext that OpenSSL has produced to output.
+  void ReadTlsOutput(std::string *output);
+
+  // Queues the ciphertext that OpenSSL has produced.
+  absl::Status QueueTlsOutput();
+
+  // Writes the queued data and, if read is true, reads from the socket in the
+  // same submission. Returns the data read, which is valid until the thread's
+  // next Exchange.
+  absl::StatusOr<absl::string_view> Exchange(bool read);
+
+  // Writes the data, which is not queued, and then reads as Exchange does.
+  absl::StatusOr<absl::string_view> Transfer(absl::string_view data, bool read);
+
+  // Reads ciphertext from the socket into OpenSSL.
+  absl::Status ReadTlsInput();
+
+  // Replaces the drained ciphertext BIO if it has grown large. A memory BIO
+  // keeps the capacity of the largest record written through it.
+  void ReleaseTlsOutput();
+
+  // Discards the queued data, freeing the buffer if it has grown large.
+  void ClearOutput();
+
+  std::string hostname_;
+  const int port_;
+  const TlsMode tls_mode_;
+  int socket_;
+  std::string address_;
+  std::shared_ptr<SmtpContext> context_;
+  SSL *ssl_;
+  // Owned by ssl_.
+  BIO *network_input_;
+  BIO *network_output_;
+  // Data queued to be written by the next Exchange.
+  std::string output_;
+  // The command being encrypted, kept to reuse its capacity. Longer lines are
+  // not copied, so it stays small.
+  std::string line_;
+  std::string reply_;
+  bool log_;
+};
+
+/** Returns an adapter that uses the given transport, or SmtpAdapterImpl if
+ * the transport is not supported on this machine. */
+std::shared_ptr<SmtpAdapter>
+NewSmtpAdapter(absl::string_view hostname, int port,
+               TlsMode tls_mode = StartTls, Transport transport = AsioTransport,
+               std::shared_ptr<SmtpContext> context = SmtpContext::Default());
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_IO_URING_ADAPTER_H
@@ -0,0 +1,166 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "io_uring_adapter.h"
+#include "gmock/gmock.h"
+#include <gtest/gtest.h>
+
+#include "absl/status/status.h"
+#include "fake_smtp_server.h"
+#include <thread>
+
+namespace ez {
+namespace smtp {
+namespace {
+
+using testing::ElementsAre;
+
+/** Runs each test against both transports, and a fake server with the
+ * parameter's tls mode. */
+class TransportTest
+    : public testing::TestWithParam<std::tuple<Transport, TlsMode>> {
+public:
+  void SetUp() override {
+    if (transport() == IoUringTransport &&
+        !IoUringSmtpAdapter::IsSupported()) {
+      GTEST_SKIP() << "io_uring is not supported";
+    }
+    server_ = std::make_unique<FakeSmtpServer>(tls_mode());
+    auto port = server_->Listen();
+    ASSERT_TRUE(port.ok());
+    port_ = *port;
+    thread_ = std::thread([this] { server_->Serve(); });
+  }
+
+  void TearDown() override {
+    if (server_ != nullptr) {
+      server_->Stop();
+      thread_.join();
+    }
+  }
+
+protected:
+  Transport transport() const { return std::get<0>(GetParam()); }
+  TlsMode tls_mode() const { return std::get<1>(GetParam()); }
+
+  std::shared_ptr<SmtpAdapter> NewAdapter() {
+    return NewSmtpAdapter("127.0.0.1", port_, tls_mode(), transport());
+  }
+
+  std::unique_ptr<FakeSmtpServer> server_;
+  std::thread thread_;
+  int port_;
+};
+
+TEST_P(TransportTest, SendsBatch) {
+  Smtp smtp("username", "password", NewAdapter(), tls_mode());
+
+  ASSERT_TRUE(smtp.Connect().ok());
+  ASSERT_TRUE(smtp.NewEmail()
+                  .SetSender("from@example.com")
+                  .AddRecipient("to@example.com")
+                  .SetSubject("First")
+                  .SetBody("Body 1")
+                  .SendBatch()
+                  .ok());
+  ASSERT_TRUE(smtp.NewEmail()
+                  .SetSender("from@example.com")
+                  .AddRecipient("to@example.com")
+                  .SetSubject("Second")
+                  .SetBody("Body 2")
+                  .SendBatch()
+                  .ok());
+  ASSERT_TRUE(smtp.Disconnect().ok());
+
+  EXPECT_THAT(server_->messages(),
+              ElementsAre("From: from@example.com\r\n"
+                          "To: to@example.com\r\n"
+                          "Subject: First\r\n\r\n"
+                          "Body 1\r\n",
+                          "From: from@example.com\r\n"
+                          "To: to@example.com\r\n"
+                          "Subject: Second\r\n\r\n"
+                          "Body 2\r\n"));
+}
+
+TEST_P(TransportTest, SendsMessageLargerThanBuffers) {
+  std::string body;
+  while (body.size() < (200 << 10)) {
+    body += "The quick brown fox jumps over the lazy dog.\r\n";
+  }
+  Smtp smtp("username", "password", NewAdapter(), tls_mode());
+
+  ASSERT_TRUE(smtp.NewEmail()
+                  .SetSender("from@example.com")
+                  .AddRecipient("to@example.com")
+                  .SetSubject("Large")
+                  .SetBody(body)
+                  .Send()
+                  .ok());
+
+  ASSERT_EQ(server_->messages().size(), 1);
+  EXPECT_EQ(server_->messages()[0].size(),
+            body.size() + std::string("From: from@example.com\r\n"
+                                      "To: to@example.com\r\n"
+                                      "Subject: Large\r\n\r\n\r\n")
+                              .size());
+}
+
+TEST_P(TransportTest, ReportsLostConnection) {
+  auto adapter = NewAdapter();
+  ASSERT_TRUE(adapter->Connect().ok());
+  ASSERT_TRUE(adapter->Read(220).ok());
+
+  server_->Stop();
+
+  // The second write fails with EPIPE, which must not raise SIGPIPE.
+  for (int i = 0; i < 2; i++) {
+    auto status = adapter->WriteLine("NOOP");
+    if (status.ok()) {
+      status = adapter->Read(250);
+    }
+    EXPECT_TRUE(absl::IsUnavailable(status)) << status;
+  }
+  adapter->Disconnect();
+}
+
+TEST_P(TransportTest, FailsWhenNotConnected) {
+  auto adapter = NewAdapter();
+
+  // Not Unavailable, which would be retried as a lost connection.
+  EXPECT_EQ(adapter->WriteLine("NOOP").code(),
+            absl::StatusCode::kFailedPrecondition);
+  EXPECT_EQ(adapter->Read(250).code(), absl::StatusCode::kFailedPrecondition);
+  EXPECT_EQ(adapter->EnableTls().code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Transports, TransportTest,
+    testing::Combine(testing::Values(AsioTransport, IoUringTransport),
+                     testing::Values(StartTls, ImplicitTls)));
+
+TEST(NewSmtpAdapterTest, SelectsTransport) {
+  EXPECT_NE(dynamic_cast<SmtpAdapterImpl *>(
+                NewSmtpAdapter("localhost", 25, StartTls, AsioTransport).get()),
+            nullptr);
+  auto adapter = NewSmtpAdapter("localhost", 25, StartTls, IoUringTransport);
+  // Falls back to Asio where io_uring is not available.
+  EXPECT_EQ(dynamic_cast<IoUringSmtpAdapter *>(adapter.get()) != nullptr,
+            IoUringSmtpAdapter::IsSupported());
+}
+
+} // namespace
+} // namespace smtp
+} // namespace ez
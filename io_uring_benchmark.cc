@@ -0,0 +1,185 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_format.h"
+#include "fake_smtp_server.h"
+#include "io_uring_adapter.h"
+#include "smtp.h"
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <iostream>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+ABSL_FLAG(int, emails, 20000, "Emails to send per measurement");
+ABSL_FLAG(int, connections, 64,
+          "Connections to send the emails over, in turn");
+ABSL_FLAG(int, traced_emails, 2000,
+          "Emails to send while counting syscalls, which is much slower");
+
+using ez::smtp::AsioTransport;
+using ez::smtp::FakeSmtpServer;
+using ez::smtp::IoUringSmtpAdapter;
+using ez::smtp::IoUringTransport;
+using ez::smtp::NewSmtpAdapter;
+using ez::smtp::Smtp;
+using ez::smtp::StartTls;
+using ez::smtp::Transport;
+
+/** Connects the given number of sessions, sends the emails over each in turn
+ * and disconnects. */
+absl::Status SendEmails(Transport transport, int port, int connections,
+                        int emails) {
+  std::vector<std::unique_ptr<Smtp>> sessions;
+  for (int i = 0; i < connections; i++) {
+    sessions.push_back(std::make_unique<Smtp>(
+        "username", "password",
+        NewSmtpAdapter("127.0.0.1", port, StartTls, transport)));
+    RETURN_IF_ERROR(sessions.back()->Connect());
+  }
+  for (int i = 0; i < emails; i++) {
+    RETURN_IF_ERROR(sessions[i % connections]
+                        ->NewEmail()
+                        .SetSender("from@example.com")
+                        .AddRecipient("to@example.com", "Joe Smith")
+                        .SetSubject("Benchmark")
+                        .SetBody("The quick brown fox jumps over the lazy dog.")
+                        .SendBatch());
+  }
+  for (auto &session : sessions) {
+    RETURN_IF_ERROR(session->Disconnect());
+  }
+  return absl::OkStatus();
+}
+
+/** Runs the function in a child process traced with ptrace, returning the
+ * number of syscalls it made, or -1 if it could not be traced or failed. */
+long CountSyscalls(const std::function<absl::Status()> &function) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+    raise(SIGSTOP);
+    _exit(function().ok() ? 0 : 1);
+  }
+  int status;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status) ||
+      ptrace(PTRACE_SETOPTIONS, pid, nullptr,
+             PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL) < 0) {
+    return -1;
+  }
+  long stops = 0;
+  int signal = 0;
+  while (ptrace(PTRACE_SYSCALL, pid, nullptr, signal) == 0 &&
+         waitpid(pid, &status, 0) == pid && WIFSTOPPED(status)) {
+    signal = 0;
+    if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+      stops++;
+    } else if (WSTOPSIG(status) != SIGSTOP) {
+      signal = WSTOPSIG(status);
+    }
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    return -1;
+  }
+  // Each syscall stops on entry and on exit, except the final exit.
+  return (stops + 1) / 2;
+}
+
+/** Prints the throughput, CPU time and syscalls per email of the Asio and
+ * io_uring transports sending to a local server, in batch mode over many
+ * connections. The server runs in a child process so that only the client is
+ * measured. CPU time includes the kernel's io_uring worker threads. Syscalls
+ * per email exclude connecting, which is shown separately. Example usage:
+ *
+ * bazel run -c opt :io_uring_benchmark -- --connections=256
+ */
+int main(int argc, char **argv) {
+  absl::ParseCommandLine(argc, argv);
+  const int connections = absl::GetFlag(FLAGS_connections);
+  const int emails = absl::GetFlag(FLAGS_emails);
+  const int traced_emails = absl::GetFlag(FLAGS_traced_emails);
+
+  FakeSmtpServer server;
+  auto port = server.Listen();
+  if (!port.ok()) {
+    std::cerr << port.status() << std::endl;
+    return 1;
+  }
+  pid_t server_pid = fork();
+  if (server_pid == 0) {
+    server.Serve();
+    _exit(0);
+  }
+
+  std::vector<Transport> transports = {AsioTransport};
+  if (IoUringSmtpAdapter::IsSupported()) {
+    transports.push_back(IoUringTransport);
+  } else {
+    std::cout << "io_uring is not supported, measuring Asio only" << std::endl;
+  }
+
+  std::cout << "transport\temails/s\tcpu us/email\tsyscalls/email\t"
+               "syscalls/connection"
+            << std::endl;
+  int result = 0;
+  for (Transport transport : transports) {
+    rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    auto start = std::chrono::steady_clock::now();
+    auto status = SendEmails(transport, *port, connections, emails);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    getrusage(RUSAGE_SELF, &after);
+    if (!status.ok()) {
+      std::cerr << status << std::endl;
+      result = 1;
+      break;
+    }
+    auto micros = [](const timeval &time) {
+      return time.tv_sec * 1e6 + time.tv_usec;
+    };
+    double cpu = micros(after.ru_utime) - micros(before.ru_utime) +
+                 micros(after.ru_stime) - micros(before.ru_stime);
+
+    // Sending no emails measures connecting and disconnecting alone.
+    long setup = CountSyscalls(
+        [&] { return SendEmails(transport, *port, connections, 0); });
+    long total = CountSyscalls([&] {
+      return SendEmails(transport, *port, connections, traced_emails);
+    });
+    std::string per_email = "n/a";
+    std::string per_connection = "n/a";
+    if (setup >= 0 && total >= 0) {
+      per_email =
+          absl::StrFormat("%.1f", double(total - setup) / traced_emails);
+      per_connection = absl::StrFormat("%.1f", double(setup) / connections);
+    }
+
+    std::cout << absl::StrFormat(
+                     "%s\t%.0f\t%.1f\t%s\t%s",
+                     transport == IoUringTransport ? "io_uring" : "asio",
+                     emails / elapsed.count(), cpu / emails, per_email,
+                     per_connection)
+              << std::endl;
+  }
+
+  kill(server_pid, SIGKILL);
+  waitpid(server_pid, nullptr, 0);
+  return result;
+}
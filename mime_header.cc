@@ -0,0 +1,264 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mime_header.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace ez {
+namespace smtp {
+namespace {
+
+// Maximum length of a line containing encoded-words, excluding the CRLF
+// (RFC 2047 2), which is also used for plain lines.
+constexpr size_t kMaxLineLength = 76;
+
+constexpr char kEncodedWordPrefix[] = "=?UTF-8?B?";
+constexpr char kEncodedWordSuffix[] = "?=";
+
+constexpr size_t kEncodedWordOverhead =
+    sizeof(kEncodedWordPrefix) - 1 + sizeof(kEncodedWordSuffix) - 1;
+
+// The most text that fits in a 75 character encoded-word (RFC 2047 2).
+constexpr size_t kMaxEncodedWordText = (75 - kEncodedWordOverhead) / 4 * 3;
+
+// The least text worth starting an encoded-word with before folding, which
+// holds any UTF-8 sequence.
+constexpr size_t kMinEncodedWordText = 6;
+
+// Characters that require a display name to be quoted (RFC 5322 3.2.3).
+constexpr char kSpecials[] = "()<>[]:;@\\,.\"";
+
+/** Writes a header field as space separated tokens, folding the line before a
+ * token that would make it too long. */
+class FoldingWriter {
+public:
+  FoldingWriter(absl::string_view field, std::string *output)
+      : output_(output), line_length_(field.size() + 1), first_(true) {
+    output_->append(field.data(), field.size());
+    output_->push_back(':');
+  }
+
+  // Appends a token made up of the given pieces.
+  void Append(std::initializer_list<absl::string_view> pieces) {
+    size_t size = 0;
+    for (absl::string_view piece : pieces) {
+      size += piece.size();
+    }
+    if (!first_ && size > 0 && line_length_ + 1 + size > kMaxLineLength) {
+      output_->append("\r\n");
+      line_length_ = 0;
+    }
+    output_->push_back(' ');
+    for (absl::string_view piece : pieces) {
+      output_->append(piece.data(), piece.size());
+    }
+    line_length_ += 1 + size;
+    first_ = false;
+  }
+
+  // Returns the length of a token that fits on the current line.
+  size_t Remaining() const {
+    return line_length_ + 1 < kMaxLineLength
+               ? kMaxLineLength - line_length_ - 1
+               : 0;
+  }
+
+  void End() { output_->append("\r\n"); }
+
+private:
+  std::string *output_;
+  size_t line_length_;
+  bool first_;
+};
+
+std::string Base64Encode(absl::string_view data) {
+  static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string result;
+  result.reserve((data.size() + 2) / 3 * 4);
+  size_t i = 0;
+  for (; i + 3 <= data.size(); i += 3) {
+    uint32_t n = static_cast<unsigned char>(data[i]) << 16 |
+                 static_cast<unsigned char>(data[i + 1]) << 8 |
+                 static_cast<unsigned char>(data[i + 2]);
+    result.push_back(kAlphabet[n >> 18]);
+    result.push_back(kAlphabet[(n >> 12) & 63]);
+    result.push_back(kAlphabet[(n >> 6) & 63]);
+    result.push_back(kAlphabet[n & 63]);
+  }
+  if (i < data.size()) {
+    uint32_t n = static_cast<unsigned char>(data[i]) << 16;
+    if (i + 1 < data.size()) {
+      n |= static_cast<unsigned char>(data[i + 1]) << 8;
+    }
+    result.push_back(kAlphabet[n >> 18]);
+    result.push_back(kAlphabet[(n >> 12) & 63]);
+    result.push_back(i + 1 < data.size() ? kAlphabet[(n >> 6) & 63] : '=');
+    result.push_back('=');
+  }
+  return result;
+}
+
+// Writes the text as encoded-words, splitting it between UTF-8 sequences. Each
+// word fills the rest of the current line, or the next line if too little of
+// the current one is left.
+void AppendEncodedWords(absl::string_view text, FoldingWriter &writer) {
+  while (!text.empty()) {
+    size_t max_size = kMaxEncodedWordText;
+    size_t remaining = writer.Remaining();
+    if (remaining >= kEncodedWordOverhead + kMinEncodedWordText / 3 * 4) {
+      max_size = std::min(max_size, (remaining - kEncodedWordOverhead) / 4 * 3);
+    }
+    size_t size = std::min(text.size(), max_size);
+    while (size > 0 && size < text.size() && (text[size] & 0xC0) == 0x80) {
+      size--;
+    }
+    if (size == 0) {
+      size = std::min(text.size(), max_size);
+    }
+    writer.Append({kEncodedWordPrefix, Base64Encode(text.substr(0, size)),
+                   kEncodedWordSuffix});
+    text.remove_prefix(size);
+  }
+}
+
+std::string Quote(absl::string_view text) {
+  std::string result = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      result.push_back('\\');
+    }
+    result.push_back(c);
+  }
+  result.push_back('"');
+  return result;
+}
+
+} // namespace
+
+bool IsPlainHeaderText(absl::string_view text) {
+  // Plain text that looks like an encoded-word must be encoded itself, so
+  // "=?" is found in the same scan. Each block is compared with the block one
+  // byte ahead, which requires a byte past the block.
+  const char *p = text.data();
+  const char *end = p + text.size();
+#if defined(__SSE2__)
+  // Bytes of 0x80 and above are negative as signed chars, so a single signed
+  // comparison finds both control characters and non-ASCII bytes.
+  const __m128i space = _mm_set1_epi8(0x20);
+  const __m128i del = _mm_set1_epi8(0x7F);
+  const __m128i equals = _mm_set1_epi8('=');
+  const __m128i question = _mm_set1_epi8('?');
+  for (; end - p > 16; p += 16) {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 1));
+    __m128i unsafe = _mm_or_si128(
+        _mm_or_si128(_mm_cmplt_epi8(chars, space), _mm_cmpeq_epi8(chars, del)),
+        _mm_and_si128(_mm_cmpeq_epi8(chars, equals),
+                      _mm_cmpeq_epi8(next, question)));
+    if (_mm_movemask_epi8(unsafe) != 0) {
+      return false;
+    }
+  }
+#elif defined(__aarch64__)
+  const uint8x16_t space = vdupq_n_u8(0x20);
+  const uint8x16_t del = vdupq_n_u8(0x7F);
+  const uint8x16_t equals = vdupq_n_u8('=');
+  const uint8x16_t question = vdupq_n_u8('?');
+  for (; end - p > 16; p += 16) {
+    uint8x16_t chars = vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+    uint8x16_t next = vld1q_u8(reinterpret_cast<const uint8_t *>(p + 1));
+    uint8x16_t unsafe =
+        vorrq_u8(vorrq_u8(vcltq_u8(chars, space), vcgeq_u8(chars, del)),
+                 vandq_u8(vceqq_u8(chars, equals), vceqq_u8(next, question)));
+    if (vmaxvq_u8(unsafe) != 0) {
+      return false;
+    }
+  }
+#endif
+  for (; p < end; p++) {
+    unsigned char c = static_cast<unsigned char>(*p);
+    if (c < 0x20 || c >= 0x7F) {
+      return false;
+    }
+    if (c == '=' && p + 1 < end && p[1] == '?') {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AppendUnstructuredHeader(absl::string_view field, absl::string_view value,
+                              std::string *output) {
+  const bool plain = IsPlainHeaderText(value);
+  if (plain && field.size() + 2 + value.size() <= kMaxLineLength) {
+    output->append(field.data(), field.size());
+    output->append(": ");
+    output->append(value.data(), value.size());
+    output->append("\r\n");
+    return;
+  }
+  FoldingWriter writer(field, output);
+  if (plain) {
+    size_t start = 0;
+    size_t space;
+    while ((space = value.find(' ', start)) != absl::string_view::npos) {
+      writer.Append({value.substr(start, space - start)});
+      start = space + 1;
+    }
+    writer.Append({value.substr(start)});
+  } else {
+    AppendEncodedWords(value, writer);
+  }
+  writer.End();
+}
+
+void AppendAddressHeader(absl::string_view field,
+                         const std::vector<Mailbox> &mailboxes,
+                         std::string *output) {
+  if (mailboxes.empty()) {
+    return;
+  }
+  FoldingWriter writer(field, output);
+  for (size_t i = 0; i < mailboxes.size(); i++) {
+    const Mailbox &mailbox = mailboxes[i];
+    const absl::string_view separator = i + 1 < mailboxes.size() ? "," : "";
+    if (mailbox.name.empty()) {
+      writer.Append({mailbox.address, separator});
+      continue;
+    }
+    if (!IsPlainHeaderText(mailbox.name)) {
+      AppendEncodedWords(mailbox.name, writer);
+    } else if (mailbox.name.find_first_of(kSpecials) !=
+               absl::string_view::npos) {
+      writer.Append({Quote(mailbox.name)});
+    } else {
+      writer.Append({mailbox.name});
+    }
+    writer.Append({"<", mailbox.address, ">", separator});
+  }
+  writer.End();
+}
+
+} // namespace smtp
+} // namespace ez
@@ -0,0 +1,54 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_MIME_HEADER_H
+#define EZ_MIME_HEADER_H
+
+#include "absl/strings/string_view.h"
+#include <string>
+#include <vector>
+
+namespace ez {
+namespace smtp {
+
+/** An address and optional display name in an address header field. */
+struct Mailbox {
+  absl::string_view address;
+  absl::string_view name;
+};
+
+/** Returns whether the text consists only of printable ASCII and may be
+ * written to a header field as is. Text containing control characters
+ * (including CR and LF), non-ASCII bytes or "=?" must be encoded. Scans the
+ * text once, 16 bytes at a time where SSE2 or NEON is available. */
+bool IsPlainHeaderText(absl::string_view text);
+
+/** Appends an unstructured header field such as Subject, including the
+ * trailing CRLF. Text that is not plain is written as RFC 2047 encoded-words
+ * (UTF-8, base64), and long lines are folded. */
+void AppendUnstructuredHeader(absl::string_view field, absl::string_view value,
+                              std::string *output);
+
+/** Appends an address header field such as To, including the trailing CRLF.
+ * Display names are quoted if they contain special characters or encoded if
+ * they are not plain, and long lines are folded between mailboxes. Appends
+ * nothing if there are no mailboxes. The addresses must already be valid. */
+void AppendAddressHeader(absl::string_view field,
+                         const std::vector<Mailbox> &mailboxes,
+                         std::string *output);
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_MIME_HEADER_H
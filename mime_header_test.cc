@@ -0,0 +1,192 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mime_header.h"
+#include <gtest/gtest.h>
+
+#include <boost/archive/iterators/binary_from_base64.hpp>
+#include <boost/archive/iterators/transform_width.hpp>
+
+namespace ez {
+namespace smtp {
+namespace {
+
+std::string Unstructured(absl::string_view value) {
+  std::string output;
+  AppendUnstructuredHeader("Subject", value, &output);
+  return output;
+}
+
+std::string Address(const std::vector<Mailbox> &mailboxes) {
+  std::string output;
+  AppendAddressHeader("To", mailboxes, &output);
+  return output;
+}
+
+std::string Base64Decode(const std::string &data) {
+  using namespace boost::archive::iterators;
+  typedef transform_width<binary_from_base64<std::string::const_iterator>, 8,
+                          6>
+      base64_binary;
+  std::string trimmed = data.substr(0, data.find('='));
+  std::string result(base64_binary(trimmed.begin()),
+                     base64_binary(trimmed.end()));
+  return result;
+}
+
+// Returns the decoded text of each encoded-word in the header field.
+std::vector<std::string> DecodeWords(absl::string_view header) {
+  std::vector<std::string> words;
+  size_t start = 0;
+  while ((start = header.find("=?UTF-8?B?", start)) !=
+         absl::string_view::npos) {
+    start += 10;
+    size_t end = header.find("?=", start);
+    words.push_back(
+        Base64Decode(std::string(header.substr(start, end - start))));
+    start = end + 2;
+  }
+  return words;
+}
+
+// Returns the length of the longest line, excluding the CRLF.
+size_t LongestLine(absl::string_view header) {
+  size_t longest = 0;
+  size_t start = 0;
+  size_t end;
+  while ((end = header.find("\r\n", start)) != absl::string_view::npos) {
+    longest = std::max(longest, end - start);
+    start = end + 2;
+  }
+  return longest;
+}
+
+TEST(MimeHeaderTest, IsPlainHeaderText) {
+  ASSERT_TRUE(IsPlainHeaderText(""));
+  ASSERT_TRUE(IsPlainHeaderText("Hello, World! ~"));
+  ASSERT_FALSE(IsPlainHeaderText("=?UTF-8?B?SGk=?="));
+  // Covers the vectorized blocks and the remaining bytes.
+  for (size_t size = 1; size < 40; size++) {
+    for (size_t i = 0; i < size; i++) {
+      for (char unsafe : {'\r', '\n', '\t', '\0', '\x7F', '\x80', '\xFF'}) {
+        std::string text(size, 'a');
+        text[i] = unsafe;
+        ASSERT_FALSE(IsPlainHeaderText(text)) << size << ", " << i;
+      }
+    }
+    ASSERT_TRUE(IsPlainHeaderText(std::string(size, ' ')));
+  }
+  // Including "=?" across the boundary of a vectorized block.
+  for (size_t size = 2; size < 40; size++) {
+    for (size_t i = 0; i + 1 < size; i++) {
+      std::string text(size, 'a');
+      text[i] = '=';
+      text[i + 1] = '?';
+      ASSERT_FALSE(IsPlainHeaderText(text)) << size << ", " << i;
+      text[i + 1] = 'a';
+      ASSERT_TRUE(IsPlainHeaderText(text)) << size << ", " << i;
+      text[i] = '?';
+      text[i + 1] = '=';
+      ASSERT_TRUE(IsPlainHeaderText(text)) << size << ", " << i;
+    }
+  }
+}
+
+TEST(MimeHeaderTest, PlainSubjectIsCopied) {
+  ASSERT_EQ(Unstructured("Hello"), "Subject: Hello\r\n");
+  ASSERT_EQ(Unstructured(""), "Subject: \r\n");
+}
+
+TEST(MimeHeaderTest, LongPlainSubjectIsFolded) {
+  std::string subject;
+  for (int i = 0; i < 30; i++) {
+    subject += "word ";
+  }
+  subject += "end";
+
+  std::string header = Unstructured(subject);
+
+  ASSERT_LE(LongestLine(header), 76);
+  std::string unfolded = header;
+  for (size_t pos; (pos = unfolded.find("\r\n ")) != std::string::npos;) {
+    unfolded.erase(pos, 2);
+  }
+  ASSERT_EQ(unfolded, "Subject: " + subject + "\r\n");
+}
+
+TEST(MimeHeaderTest, NonAsciiSubjectIsEncoded) {
+  ASSERT_EQ(Unstructured("Grüße aus München"),
+            "Subject: =?UTF-8?B?R3LDvMOfZSBhdXMgTcO8bmNoZW4=?=\r\n");
+}
+
+TEST(MimeHeaderTest, LineBreaksAreEncoded) {
+  std::string header = Unstructured("Hi\r\nBcc: victim@example.com");
+
+  ASSERT_EQ(header.find("\r\n"), header.size() - 2);
+  ASSERT_EQ(DecodeWords(header),
+            std::vector<std::string>{"Hi\r\nBcc: victim@example.com"});
+}
+
+TEST(MimeHeaderTest, LongSubjectIsSplitBetweenCharacters) {
+  std::string subject;
+  for (int i = 0; i < 40; i++) {
+    subject += "日本語";
+  }
+
+  std::string header = Unstructured(subject);
+
+  ASSERT_LE(LongestLine(header), 76);
+  std::string decoded;
+  for (const std::string &word : DecodeWords(header)) {
+    ASSERT_NE(static_cast<unsigned char>(word[0]) & 0xC0, 0x80);
+    ASSERT_EQ(word.size() % 3, 0);
+    decoded += word;
+  }
+  ASSERT_EQ(decoded, subject);
+}
+
+TEST(MimeHeaderTest, AddressHeader) {
+  ASSERT_EQ(Address({}), "");
+  ASSERT_EQ(Address({{"a@example.com", ""}, {"b@example.com", "joe smith"}}),
+            "To: a@example.com, joe smith <b@example.com>\r\n");
+}
+
+TEST(MimeHeaderTest, DisplayNamesAreQuotedOrEncoded) {
+  ASSERT_EQ(Address({{"a@example.com", "Smith, \"Joe\""}}),
+            "To: \"Smith, \\\"Joe\\\"\" <a@example.com>\r\n");
+  ASSERT_EQ(Address({{"jose@example.com", "José"}}),
+            "To: =?UTF-8?B?Sm9zw6k=?= <jose@example.com>\r\n");
+}
+
+TEST(MimeHeaderTest, LongAddressHeaderIsFoldedBetweenMailboxes) {
+  std::vector<std::string> addresses;
+  for (int i = 0; i < 10; i++) {
+    addresses.push_back("recipient" + std::to_string(i) + "@example.com");
+  }
+  std::vector<Mailbox> mailboxes;
+  for (const std::string &address : addresses) {
+    mailboxes.push_back({address, ""});
+  }
+
+  std::string header = Address(mailboxes);
+
+  ASSERT_LE(LongestLine(header), 76);
+  ASSERT_EQ(header.find("To: recipient0@example.com, recipient1@example.com,"),
+            0);
+  ASSERT_NE(header.find(",\r\n recipient"), std::string::npos);
+}
+
+} // namespace
+} // namespace smtp
+} // namespace ez
@@ -0,0 +1,77 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_MPSC_QUEUE_H
+#define EZ_MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace ez {
+namespace smtp {
+
+/** Unbounded lock-free queue with many producers and a single consumer.
+ *
+ * Push may be called from any thread. Pop must only be called by one thread
+ * at a time; callers that share the consumer side must serialize it
+ * themselves. Pop may briefly return false while a concurrent Push is
+ * linking its node, so consumers should track pending work separately.
+ */
+template <typename T> class MpscQueue {
+public:
+  MpscQueue() : head_(new Node()), tail_(head_.load()) {}
+
+  ~MpscQueue() {
+    T value;
+    while (Pop(&value)) {
+    }
+    delete tail_;
+  }
+
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  void Push(T value) {
+    Node *node = new Node(std::move(value));
+    Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  bool Pop(T *value) {
+    Node *next = tail_->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return false;
+    }
+    *value = std::move(next->value);
+    delete tail_;
+    tail_ = next;
+    return true;
+  }
+
+private:
+  struct Node {
+    Node() : next(nullptr) {}
+    explicit Node(T v) : value(std::move(v)), next(nullptr) {}
+    T value;
+    std::atomic<Node *> next;
+  };
+
+  std::atomic<Node *> head_;
+  Node *tail_;
+};
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_MPSC_QUEUE_H
@@ -0,0 +1,40 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pooled_session.h"
+
+#include "status_macros.h"
+
+namespace ez {
+namespace smtp {
+
+absl::Status SendPooled(Smtp &smtp, const Email &email) {
+  if (!smtp.connected()) {
+    RETURN_IF_ERROR(smtp.Connect());
+  }
+  auto status = smtp.NewEmail(email).SendBatch();
+  if (!status.ok()) {
+    smtp.Disconnect().IgnoreError();
+  }
+  return status;
+}
+
+void KeepAlivePooled(Smtp &smtp) {
+  if (smtp.connected() && !smtp.KeepAlive().ok()) {
+    smtp.Disconnect().IgnoreError();
+  }
+}
+
+} // namespace smtp
+} // namespace ez
@@ -0,0 +1,38 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_POOLED_SESSION_H
+#define EZ_POOLED_SESSION_H
+
+#include "absl/status/status.h"
+#include "smtp.h"
+
+namespace ez {
+namespace smtp {
+
+// Helpers for a batch mode session owned by a sender thread, as in
+// ShardedSender and PrioritySender. The session connects on its first email
+// and is disconnected after a failed send, so that the next email starts
+// over on a new connection.
+
+/** Sends an email, connecting the session first if it is not connected. */
+absl::Status SendPooled(Smtp &smtp, const Email &email);
+
+/** Keeps an idle session open, disconnecting it if that fails. */
+void KeepAlivePooled(Smtp &smtp);
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_POOLED_SESSION_H
@@ -0,0 +1,178 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "priority_sender.h"
+
+#include "pooled_session.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ez {
+namespace smtp {
+
+PrioritySender::PrioritySender(SmtpFactory factory, const Options &options)
+    : factory_(std::move(factory)), options_(options) {
+  const int num_sessions = std::max(1, options_.num_sessions);
+  // At least one session must be left to send bulk email.
+  const int reserved_sessions =
+      std::clamp(options_.reserved_sessions, 0, num_sessions - 1);
+  for (int i = 0; i < num_sessions; i++) {
+    sessions_.emplace_back(new Session());
+    sessions_.back()->reserved = i < reserved_sessions;
+  }
+  for (auto &session : sessions_) {
+    session->thread = std::thread(&PrioritySender::Run, this, std::ref(*session));
+  }
+}
+
+void PrioritySender::Submit(Priority priority, Email email, Callback done) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stopping_) {
+      Lane &lane = lanes_[priority];
+      lane.queue.push_back(Job{std::move(email), std::move(done), Clock::now()});
+      lane.submitted++;
+      done = nullptr;
+    }
+  }
+  if (done) {
+    done(absl::FailedPreconditionError("The sender has been shut down"));
+    return;
+  }
+  if (priority == Transactional) {
+    reserved_work_.notify_one();
+  }
+  work_.notify_one();
+}
+
+void PrioritySender::Shutdown() {
+  std::lock_guard<std::mutex> shutdown_lock(shutdown_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      return;
+    }
+    stopping_ = true;
+  }
+  reserved_work_.notify_all();
+  work_.notify_all();
+  for (auto &session : sessions_) {
+    session->thread.join();
+  }
+}
+
+PrioritySender::LaneStats PrioritySender::Stats(Priority priority) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Lane &lane = lanes_[priority];
+  LaneStats stats;
+  stats.submitted = lane.submitted;
+  stats.sent = lane.sent;
+  stats.failed = lane.failed;
+  stats.queued = lane.queue.size();
+  stats.p50_delay = std::min(DelayPercentile(lane.delays, 0.5), lane.max_delay);
+  stats.p99_delay =
+      std::min(DelayPercentile(lane.delays, 0.99), lane.max_delay);
+  stats.max_delay = lane.max_delay;
+  return stats;
+}
+
+void PrioritySender::Run(Session &session) {
+  session.smtp = factory_();
+  std::condition_variable &wake = session.reserved ? reserved_work_ : work_;
+  while (true) {
+    Job job;
+    int priority;
+    bool idle = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      priority = TakeJob(session, &job);
+      if (priority < 0) {
+        if (stopping_) {
+          break;
+        }
+        idle = wake.wait_for(lock, options_.idle_wait) ==
+               std::cv_status::timeout;
+      }
+    }
+    if (priority >= 0) {
+      SendJob(session, job, static_cast<Priority>(priority));
+    } else if (idle) {
+      KeepAlivePooled(*session.smtp);
+    }
+  }
+  session.smtp->Disconnect().IgnoreError();
+}
+
+int PrioritySender::TakeJob(const Session &session, Job *job) {
+  const int lanes = session.reserved ? Transactional + 1 : kLanes;
+  for (int priority = 0; priority < lanes; priority++) {
+    Lane &lane = lanes_[priority];
+    if (lane.queue.empty()) {
+      continue;
+    }
+    *job = std::move(lane.queue.front());
+    lane.queue.pop_front();
+    auto delay = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - job->submitted);
+    lane.delays[DelayBucket(delay)]++;
+    lane.max_delay = std::max(lane.max_delay, delay);
+    return priority;
+  }
+  return -1;
+}
+
+void PrioritySender::SendJob(Session &session, Job &job, Priority priority) {
+  const absl::Status status = SendPooled(*session.smtp, job.email);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (status.ok()) {
+      lanes_[priority].sent++;
+    } else {
+      lanes_[priority].failed++;
+    }
+  }
+  if (job.done) {
+    job.done(status);
+  }
+}
+
+int PrioritySender::DelayBucket(std::chrono::microseconds delay) {
+  if (delay.count() < 1) {
+    return 0;
+  }
+  const int bucket =
+      1 + static_cast<int>(std::log2(delay.count()) * kBucketsPerDoubling);
+  return std::min(bucket, kDelayBuckets - 1);
+}
+
+std::chrono::microseconds PrioritySender::DelayPercentile(
+    const std::array<uint64_t, kDelayBuckets> &delays, double fraction) {
+  uint64_t total = 0;
+  for (uint64_t count : delays) {
+    total += count;
+  }
+  const uint64_t rank = std::ceil(total * fraction);
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < kDelayBuckets; bucket++) {
+    seen += delays[bucket];
+    if (seen >= rank && seen > 0) {
+      return std::chrono::microseconds(static_cast<int64_t>(
+          std::ceil(std::exp2(double(bucket) / kBucketsPerDoubling))));
+    }
+  }
+  return std::chrono::microseconds(0);
+}
+
+} // namespace smtp
+} // namespace ez
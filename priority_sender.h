@@ -0,0 +1,177 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_PRIORITY_SENDER_H
+#define EZ_PRIORITY_SENDER_H
+
+#include "absl/status/status.h"
+#include "smtp.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ez {
+namespace smtp {
+
+/** The lanes of a PrioritySender, from highest to lowest priority. */
+enum Priority { Transactional = 0, Bulk = 1 };
+
+/** Sends queued emails over a pool of sessions, with transactional email
+ * (password resets, sign in codes) ahead of bulk email (newsletters).
+ *
+ * Each session sends one email at a time and then takes the next, always
+ * from the transactional lane first, so a bulk campaign is preempted at the
+ * next message boundary. Some sessions are reserved for the transactional
+ * lane, so that transactional email does not wait for a bulk email to finish
+ * either. The time each email waits in its lane is reported by Stats.
+ *
+ *   PrioritySender sender([] {
+ *     return std::make_unique<Smtp>("smtp.sendgrid.net", 587, "username",
+ *                                   "password");
+ *   });
+ *   for (const Email &newsletter : campaign) {
+ *     sender.Submit(Bulk, newsletter);
+ *   }
+ *   sender.Submit(Transactional, password_reset, [](absl::Status status) {
+ *     if (!status.ok()) {
+ *       std::cerr << status << std::endl;
+ *     }
+ *   });
+ *   sender.Shutdown();
+ */
+class PrioritySender {
+public:
+  typedef std::function<std::unique_ptr<Smtp>()> SmtpFactory;
+  typedef std::function<void(absl::Status)> Callback;
+
+  struct Options {
+    // Number of sessions sending in parallel.
+    int num_sessions = 4;
+
+    // Of num_sessions, the number that only send transactional email. At
+    // least one session is left for bulk email.
+    int reserved_sessions = 1;
+
+    // How long an idle session sleeps before keeping its connection alive.
+    std::chrono::milliseconds idle_wait = std::chrono::milliseconds(10);
+  };
+
+  struct LaneStats {
+    uint64_t submitted = 0;
+    uint64_t sent = 0;
+    uint64_t failed = 0;
+    // Emails waiting to be sent.
+    uint64_t queued = 0;
+    // Percentiles of the time from Submit until sending started, accurate to
+    // within 20%.
+    std::chrono::microseconds p50_delay = std::chrono::microseconds(0);
+    std::chrono::microseconds p99_delay = std::chrono::microseconds(0);
+    std::chrono::microseconds max_delay = std::chrono::microseconds(0);
+  };
+
+  explicit PrioritySender(SmtpFactory factory)
+      : PrioritySender(factory, {}) {}
+
+  PrioritySender(SmtpFactory factory, const Options &options);
+
+  /** Sends any queued emails, then stops the sessions. */
+  ~PrioritySender() { Shutdown(); }
+
+  PrioritySender(const PrioritySender &) = delete;
+  PrioritySender &operator=(const PrioritySender &) = delete;
+
+  /** Queues an email in the priority's lane. May be called from any thread.
+   * The callback is invoked from a session thread once the email has been
+   * sent or failed. */
+  void Submit(Priority priority, Email email, Callback done = nullptr);
+
+  /** Waits for all queued emails to be sent, disconnects and stops the
+   * sessions. Emails submitted afterwards fail immediately. */
+  void Shutdown();
+
+  LaneStats Stats(Priority priority) const;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr int kLanes = 2;
+
+  // Buckets per doubling of the delay in microseconds.
+  static constexpr int kBucketsPerDoubling = 4;
+
+  // Covers delays up to 2^40 microseconds, about 12 days.
+  static constexpr int kDelayBuckets = 40 * kBucketsPerDoubling + 1;
+
+  struct Job {
+    Email email;
+    Callback done;
+    Clock::time_point submitted;
+  };
+
+  struct Lane {
+    std::deque<Job> queue;
+    uint64_t submitted = 0;
+    uint64_t sent = 0;
+    uint64_t failed = 0;
+    // Counts of queueing delays on a log scale.
+    std::array<uint64_t, kDelayBuckets> delays = {};
+    std::chrono::microseconds max_delay = std::chrono::microseconds(0);
+  };
+
+  struct Session {
+    std::unique_ptr<Smtp> smtp;
+    bool reserved = false;
+    std::thread thread;
+  };
+
+  void Run(Session &session);
+
+  // Takes the next job the session may send, returning its priority, or -1
+  // if there is none.
+  int TakeJob(const Session &session, Job *job);
+
+  void SendJob(Session &session, Job &job, Priority priority);
+
+  static int DelayBucket(std::chrono::microseconds delay);
+
+  // Returns the delay at the upper bound of the bucket holding the given
+  // fraction of delays.
+  static std::chrono::microseconds
+  DelayPercentile(const std::array<uint64_t, kDelayBuckets> &delays,
+                  double fraction);
+
+  SmtpFactory factory_;
+  Options options_;
+  std::vector<std::unique_ptr<Session>> sessions_;
+  mutable std::mutex mutex_;
+  // Signaled when transactional email is queued, waking the reserved
+  // sessions, and for all email, waking the others.
+  std::condition_variable reserved_work_;
+  std::condition_variable work_;
+  std::array<Lane, kLanes> lanes_;
+  bool stopping_ = false;
+  std::mutex shutdown_mutex_;
+};
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_PRIORITY_SENDER_H
@@ -0,0 +1,111 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_format.h"
+#include "fake_smtp_adapter.h"
+#include "priority_sender.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+ABSL_FLAG(int, bulk_emails, 1000000, "Emails in the bulk campaign");
+ABSL_FLAG(int, bulk_backlog, 10000,
+          "Bulk emails kept queued while the campaign is submitted");
+ABSL_FLAG(int, transactional_per_second, 100,
+          "Rate of transactional emails submitted while the campaign drains");
+ABSL_FLAG(int, sessions, 8, "Sessions sending in parallel");
+ABSL_FLAG(int, reserved_sessions, 1,
+          "Sessions that only send transactional email");
+ABSL_FLAG(int, latency_us, 0, "Simulated server latency per reply");
+
+using ez::smtp::Bulk;
+using ez::smtp::Email;
+using ez::smtp::FakeSmtpAdapter;
+using ez::smtp::NewTestEmail;
+using ez::smtp::Priority;
+using ez::smtp::PrioritySender;
+using ez::smtp::Smtp;
+using ez::smtp::Transactional;
+
+/** Drains a bulk campaign through a PrioritySender while submitting
+ * transactional email at a steady rate, then prints the queueing delay of
+ * each lane. Example usage:
+ *
+ * bazel run -c opt :priority_sender_loadgen -- --latency_us=100
+ */
+int main(int argc, char **argv) {
+  absl::ParseCommandLine(argc, argv);
+  const std::chrono::microseconds latency(absl::GetFlag(FLAGS_latency_us));
+
+  PrioritySender::Options options;
+  options.num_sessions = absl::GetFlag(FLAGS_sessions);
+  options.reserved_sessions = absl::GetFlag(FLAGS_reserved_sessions);
+  PrioritySender sender(
+      [latency] {
+        return std::make_unique<Smtp>(
+            "username", "password", std::make_shared<FakeSmtpAdapter>(latency));
+      },
+      options);
+
+  std::atomic<bool> campaign_done(false);
+  std::thread campaign([&] {
+    const Email newsletter =
+        NewTestEmail("Newsletter", std::string(2048, 'x'));
+    const uint64_t backlog = absl::GetFlag(FLAGS_bulk_backlog);
+    for (int i = 0; i < absl::GetFlag(FLAGS_bulk_emails);) {
+      if (sender.Stats(Bulk).queued >= backlog) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+      sender.Submit(Bulk, newsletter);
+      i++;
+    }
+    while (sender.Stats(Bulk).queued > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    campaign_done = true;
+  });
+
+  const Email password_reset =
+      NewTestEmail("Password reset", std::string(512, 'x'));
+  const auto interval = std::chrono::microseconds(
+      1000000 / std::max(1, absl::GetFlag(FLAGS_transactional_per_second)));
+  auto next = std::chrono::steady_clock::now();
+  while (!campaign_done) {
+    sender.Submit(Transactional, password_reset);
+    next += interval;
+    std::this_thread::sleep_until(next);
+  }
+  campaign.join();
+  sender.Shutdown();
+
+  std::cout << "lane\temails\tp50 ms\tp99 ms\tmax ms" << std::endl;
+  for (Priority priority : {Transactional, Bulk}) {
+    PrioritySender::LaneStats stats = sender.Stats(priority);
+    auto millis = [](std::chrono::microseconds delay) {
+      return delay.count() / 1000.0;
+    };
+    std::cout << absl::StrFormat(
+                     "%s\t%d\t%.1f\t%.1f\t%.1f",
+                     priority == Transactional ? "transactional" : "bulk",
+                     stats.sent, millis(stats.p50_delay),
+                     millis(stats.p99_delay), millis(stats.max_delay))
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,188 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "priority_sender.h"
+#include "gmock/gmock.h"
+#include <gtest/gtest.h>
+
+#include "absl/status/status.h"
+#include "fake_smtp_adapter.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace ez {
+namespace smtp {
+namespace {
+
+using testing::ElementsAre;
+
+/** Records the order in which emails complete. */
+class Completions {
+public:
+  PrioritySender::Callback Callback(std::string name) {
+    return [this, name](absl::Status status) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (status.ok()) {
+        order_.push_back(name);
+      }
+      condition_.notify_all();
+    };
+  }
+
+  void WaitFor(absl::string_view name) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [&] {
+      return std::find(order_.begin(), order_.end(), name) != order_.end();
+    });
+  }
+
+  std::vector<std::string> order() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return order_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<std::string> order_;
+};
+
+class PrioritySenderTest : public testing::Test {
+protected:
+  std::unique_ptr<PrioritySender> NewSender(int num_sessions,
+                                            int reserved_sessions) {
+    PrioritySender::Options options;
+    options.num_sessions = num_sessions;
+    options.reserved_sessions = reserved_sessions;
+    return std::make_unique<PrioritySender>(
+        [this] {
+          return std::make_unique<Smtp>(
+              "username", "password",
+              std::make_shared<FakeSmtpAdapter>(&gate_));
+        },
+        options);
+  }
+
+  Gate gate_;
+  Completions completions_;
+};
+
+TEST_F(PrioritySenderTest, SendsAllEmails) {
+  auto sender = NewSender(3, 1);
+  for (int i = 0; i < 50; i++) {
+    sender->Submit(Bulk, NewTestEmail("Subject"));
+    sender->Submit(Transactional, NewTestEmail("Subject"));
+  }
+  sender->Shutdown();
+
+  for (Priority priority : {Transactional, Bulk}) {
+    PrioritySender::LaneStats stats = sender->Stats(priority);
+    EXPECT_EQ(stats.submitted, 50);
+    EXPECT_EQ(stats.sent, 50);
+    EXPECT_EQ(stats.failed, 0);
+    EXPECT_EQ(stats.queued, 0);
+    EXPECT_LE(stats.p50_delay, stats.p99_delay);
+    EXPECT_LE(stats.p99_delay, stats.max_delay);
+  }
+}
+
+TEST_F(PrioritySenderTest, ReservedSessionSendsWhileBulkIsBlocked) {
+  auto sender = NewSender(2, 1);
+  for (int i = 0; i < 10; i++) {
+    sender->Submit(Bulk, NewTestEmail("block"));
+  }
+  gate_.WaitForBlocked(1);
+
+  sender->Submit(Transactional, NewTestEmail("Subject"),
+                 completions_.Callback("transactional"));
+
+  completions_.WaitFor("transactional");
+  PrioritySender::LaneStats bulk = sender->Stats(Bulk);
+  EXPECT_EQ(bulk.sent, 0);
+  EXPECT_EQ(bulk.queued, 9);
+  gate_.Open();
+  sender->Shutdown();
+  EXPECT_EQ(sender->Stats(Bulk).sent, 10);
+}
+
+TEST_F(PrioritySenderTest, TransactionalPreemptsBulkAtMessageBoundary) {
+  auto sender = NewSender(1, 0);
+  sender->Submit(Bulk, NewTestEmail("block"), completions_.Callback("bulk 1"));
+  sender->Submit(Bulk, NewTestEmail("Subject"),
+                 completions_.Callback("bulk 2"));
+  sender->Submit(Bulk, NewTestEmail("Subject"),
+                 completions_.Callback("bulk 3"));
+  gate_.WaitForBlocked(1);
+
+  sender->Submit(Transactional, NewTestEmail("Subject"),
+                 completions_.Callback("transactional"));
+  gate_.Open();
+  sender->Shutdown();
+
+  EXPECT_THAT(completions_.order(),
+              ElementsAre("bulk 1", "transactional", "bulk 2", "bulk 3"));
+}
+
+TEST_F(PrioritySenderTest, ReportsQueueingDelay) {
+  auto sender = NewSender(1, 0);
+  sender->Submit(Bulk, NewTestEmail("block"));
+  gate_.WaitForBlocked(1);
+  sender->Submit(Bulk, NewTestEmail("Subject"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  gate_.Open();
+  sender->Shutdown();
+
+  PrioritySender::LaneStats stats = sender->Stats(Bulk);
+  EXPECT_GE(stats.max_delay, std::chrono::milliseconds(20));
+  EXPECT_GE(stats.p99_delay, std::chrono::milliseconds(20));
+  EXPECT_LT(stats.p50_delay, std::chrono::milliseconds(20));
+}
+
+TEST(PrioritySenderReconnectTest, SurvivesFailedReconnect) {
+  std::atomic<int> misuses{0};
+  PrioritySender::Options options;
+  options.num_sessions = 1;
+  options.reserved_sessions = 0;
+  PrioritySender sender(
+      [&misuses] {
+        return std::make_unique<Smtp>(
+            "username", "password",
+            std::make_shared<RefusingSmtpAdapter>(&misuses));
+      },
+      options);
+  sender.Submit(Bulk, NewTestEmail("Subject"));
+  sender.Submit(Transactional, NewTestEmail("Subject"));
+  sender.Shutdown();
+
+  EXPECT_EQ(sender.Stats(Bulk).failed + sender.Stats(Transactional).failed,
+            2);
+  EXPECT_EQ(misuses, 0);
+}
+
+TEST_F(PrioritySenderTest, SubmitAfterShutdownFails) {
+  auto sender = NewSender(1, 0);
+  sender->Shutdown();
+
+  absl::Status result;
+  sender->Submit(Transactional, NewTestEmail("Subject"),
+                 [&](absl::Status status) { result = status; });
+  ASSERT_TRUE(absl::IsFailedPrecondition(result));
+}
+
+} // namespace
+} // namespace smtp
+} // namespace ez
@@ -0,0 +1,239 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "relay_set.h"
+
+namespace ez {
+namespace smtp {
+namespace {
+
+// Returns whether the failure may not recur on another attempt: a lost
+// connection, timeout or 4xx reply.
+bool IsTransient(const absl::Status &status) {
+  return absl::IsUnavailable(status) || absl::IsAborted(status) ||
+         absl::IsDeadlineExceeded(status);
+}
+
+} // namespace
+
+RelaySet::RelaySet(const Options &options) : options_(options) {
+  if (options_.health_check_interval.count() > 0) {
+    health_thread_ = std::thread(&RelaySet::RunHealthChecks, this);
+  }
+}
+
+RelaySet::~RelaySet() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  stop_.notify_all();
+  if (health_thread_.joinable()) {
+    health_thread_.join();
+  }
+  for (auto &relay : relays_) {
+    for (auto &session : relay->idle) {
+      session->Disconnect().IgnoreError();
+    }
+  }
+}
+
+void RelaySet::AddRelay(absl::string_view name, SmtpFactory factory) {
+  auto relay = std::make_unique<Relay>();
+  relay->stats.name = std::string(name);
+  relay->factory = std::move(factory);
+  std::lock_guard<std::mutex> lock(mutex_);
+  relays_.push_back(std::move(relay));
+}
+
+absl::Status RelaySet::Send(const Email &email) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<bool> tried(relays_.size(), false);
+  absl::Status status = absl::UnavailableError("No relay is available");
+  int previous = -1;
+  for (int attempt = 0; attempt < options_.max_attempts; attempt++) {
+    const int index = SelectRelay(tried);
+    if (index < 0) {
+      break;
+    }
+    if (previous >= 0) {
+      relays_[previous]->stats.failed_over++;
+    }
+    tried[index] = true;
+    relays_[index]->stats.in_flight++;
+    lock.unlock();
+
+    bool data_sent = false;
+    bool connected = false;
+    Clock::duration latency(0);
+    auto session = TakeSession(index);
+    if (session.ok()) {
+      const auto start = Clock::now();
+      status = (*session)->NewEmail(email).SendBatch();
+      latency = Clock::now() - start;
+      data_sent = (*session)->data_sent();
+      connected = (*session)->connected();
+    } else {
+      status = session.status();
+    }
+
+    lock.lock();
+    Relay &relay = *relays_[index];
+    relay.stats.in_flight--;
+    if (status.ok()) {
+      relay.stats.sent++;
+      relay.stats.consecutive_failures = 0;
+      const auto now = Clock::now();
+      const auto sample =
+          std::chrono::duration_cast<std::chrono::microseconds>(latency);
+      // A stale average is replaced rather than smoothed.
+      relay.stats.latency =
+          IsMeasured(relay, now)
+              ? std::chrono::microseconds(static_cast<int64_t>(
+                    options_.latency_weight * sample.count() +
+                    (1 - options_.latency_weight) *
+                        relay.stats.latency.count()))
+              : sample;
+      relay.measured = true;
+      relay.measured_at = now;
+      relay.idle.push_back(*std::move(session));
+      return status;
+    }
+    relay.stats.failed++;
+    if (connected && !IsTransient(status)) {
+      // The relay is working, but rejected the email, e.g. with a 5xx reply to
+      // MAIL, RCPT or DATA.
+      relay.stats.consecutive_failures = 0;
+      return status;
+    }
+    // Connecting or logging in failed (possibly while reconnecting), or the
+    // failure is transient, so another relay may succeed.
+    RecordFailure(relay);
+    if (data_sent) {
+      return status;
+    }
+    previous = index;
+  }
+  return status;
+}
+
+void RelaySet::CheckHealth() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (size_t index = 0; index < relays_.size(); index++) {
+    Relay &relay = *relays_[index];
+    if (relay.stats.state == Open) {
+      lock.unlock();
+      std::unique_ptr<Smtp> session = relay.factory();
+      const bool healthy = session->Connect().ok();
+      lock.lock();
+      if (healthy) {
+        relay.stats.state = Closed;
+        relay.stats.consecutive_failures = 0;
+        relay.idle.push_back(std::move(session));
+      }
+      continue;
+    }
+    std::vector<std::unique_ptr<Smtp>> sessions;
+    sessions.swap(relay.idle);
+    lock.unlock();
+    std::vector<std::unique_ptr<Smtp>> healthy;
+    for (auto &session : sessions) {
+      if (session->KeepAlive().ok()) {
+        healthy.push_back(std::move(session));
+      }
+    }
+    lock.lock();
+    for (auto &session : healthy) {
+      relay.idle.push_back(std::move(session));
+    }
+  }
+}
+
+std::vector<RelaySet::RelayStats> RelaySet::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<RelayStats> stats;
+  for (const auto &relay : relays_) {
+    stats.push_back(relay->stats);
+  }
+  return stats;
+}
+
+int RelaySet::SelectRelay(const std::vector<bool> &tried) const {
+  const auto now = Clock::now();
+  int best = -1;
+  double best_score = 0;
+  for (size_t index = 0; index < relays_.size(); index++) {
+    const Relay &relay = *relays_[index];
+    const RelayStats &stats = relay.stats;
+    if (tried[index] || stats.state == Open) {
+      continue;
+    }
+    // The expected wait if each email in flight takes the average latency. A
+    // relay that has not been measured, or not recently, scores by load
+    // alone, so it is tried.
+    const double latency =
+        IsMeasured(relay, now) ? stats.latency.count() : 0.0;
+    const double score = (latency + 1.0) * (stats.in_flight + 1);
+    if (best < 0 || score < best_score) {
+      best = index;
+      best_score = score;
+    }
+  }
+  return best;
+}
+
+bool RelaySet::IsMeasured(const Relay &relay, Clock::time_point now) const {
+  return relay.measured && now - relay.measured_at < options_.latency_ttl;
+}
+
+absl::StatusOr<std::unique_ptr<Smtp>> RelaySet::TakeSession(int index) {
+  Relay *relay;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    relay = relays_[index].get();
+    if (!relay->idle.empty()) {
+      std::unique_ptr<Smtp> session = std::move(relay->idle.back());
+      relay->idle.pop_back();
+      return session;
+    }
+  }
+  std::unique_ptr<Smtp> session = relay->factory();
+  RETURN_IF_ERROR(session->Connect());
+  return session;
+}
+
+void RelaySet::RecordFailure(Relay &relay) {
+  relay.stats.consecutive_failures++;
+  if (relay.stats.consecutive_failures >= options_.failure_threshold) {
+    relay.stats.state = Open;
+    // Sessions of a failing relay are likely broken too.
+    relay.idle.clear();
+  }
+}
+
+void RelaySet::RunHealthChecks() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    stop_.wait_for(lock, options_.health_check_interval);
+    if (stopping_) {
+      break;
+    }
+    lock.unlock();
+    CheckHealth();
+    lock.lock();
+  }
+}
+
+} // namespace smtp
+} // namespace ez
@@ -0,0 +1,172 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_RELAY_SET_H
+#define EZ_RELAY_SET_H
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "smtp.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ez {
+namespace smtp {
+
+/** Sends email through whichever of several relays is healthy and fastest,
+ * failing over between them.
+ *
+ * Each email goes to the relay with the lowest smoothed (EWMA) send latency,
+ * weighted by the number of emails it is already sending. A relay that has
+ * not been sent through for latency_ttl is measured again. If the relay
+ * cannot be connected to or logged in to, or sending fails with a transient
+ * error (lost connection, 421 or other 4xx reply) before the message data was
+ * written, the email is retried on another relay. Once
+ * data was written, the relay may have accepted it, so it is not resent.
+ *
+ * A relay's circuit opens after consecutive transient failures, and no email
+ * is sent through it until it passes a health check, which connects and logs
+ * in. Health checks run in the background and also keep idle sessions open.
+ *
+ *   RelaySet relays;
+ *   relays.AddRelay("primary", [] {
+ *     return std::make_unique<Smtp>("smtp1.example.com", 587, "username",
+ *                                   "password");
+ *   });
+ *   relays.AddRelay("secondary", [] {
+ *     return std::make_unique<Smtp>("smtp2.example.com", 587, "username",
+ *                                   "password");
+ *   });
+ *   RETURN_IF_ERROR(relays.Send(email));
+ */
+class RelaySet {
+public:
+  typedef std::function<std::unique_ptr<Smtp>()> SmtpFactory;
+
+  enum CircuitState {
+    // Sending normally.
+    Closed = 0,
+    // Failing, so skipped until a health check succeeds.
+    Open = 1,
+  };
+
+  struct Options {
+    // Consecutive transient failures after which a relay's circuit opens.
+    int failure_threshold = 3;
+
+    // Relays tried per email, including the first.
+    int max_attempts = 3;
+
+    // Weight of the newest send latency in each relay's moving average.
+    double latency_weight = 0.2;
+
+    // How long a relay's latency is trusted without sending through it. A
+    // relay not sent through for longer is tried again, as if unmeasured, so
+    // that a relay measured as slow once is not skipped forever.
+    std::chrono::milliseconds latency_ttl = std::chrono::minutes(1);
+
+    // How often to run CheckHealth in the background, or 0 to only run it
+    // when called.
+    std::chrono::milliseconds health_check_interval = std::chrono::seconds(10);
+  };
+
+  struct RelayStats {
+    std::string name;
+    CircuitState state = Closed;
+    uint64_t sent = 0;
+    uint64_t failed = 0;
+    // Emails that failed on this relay and were retried on another.
+    uint64_t failed_over = 0;
+    int in_flight = 0;
+    int consecutive_failures = 0;
+    // Moving average of the time to send an email once connected.
+    std::chrono::microseconds latency = std::chrono::microseconds(0);
+  };
+
+  RelaySet() : RelaySet(Options()) {}
+
+  explicit RelaySet(const Options &options);
+
+  /** Stops health checks and disconnects idle sessions. Sends must have
+   * returned. */
+  ~RelaySet();
+
+  RelaySet(const RelaySet &) = delete;
+  RelaySet &operator=(const RelaySet &) = delete;
+
+  /** Adds a relay, which creates a session with the factory for each email it
+   * sends in parallel. Add all relays before sending. */
+  void AddRelay(absl::string_view name, SmtpFactory factory);
+
+  /** Sends the email through the best available relay, failing over to
+   * others. Returns an Unavailable error if no relay is available. An email
+   * rejected by a relay (e.g. a 5xx reply to MAIL, RCPT or DATA) is not
+   * retried. May be called from any thread. */
+  absl::Status Send(const Email &email);
+
+  /** Logs in to each relay whose circuit is open, closing it on success, and
+   * keeps idle sessions of the others open. */
+  void CheckHealth();
+
+  std::vector<RelayStats> Stats() const;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Relay {
+    RelayStats stats;
+    SmtpFactory factory;
+    // Connected sessions not sending.
+    std::vector<std::unique_ptr<Smtp>> idle;
+    // Whether the latency has been measured, and when it last was.
+    bool measured = false;
+    Clock::time_point measured_at;
+  };
+
+  // Returns the index of the available relay with the lowest expected latency
+  // that has not been tried, or -1 if there is none. Requires mutex_.
+  int SelectRelay(const std::vector<bool> &tried) const;
+
+  // Returns whether the relay's latency was measured within latency_ttl.
+  // Requires mutex_.
+  bool IsMeasured(const Relay &relay, Clock::time_point now) const;
+
+  // Returns an idle session of the relay, or a new one that is connected.
+  absl::StatusOr<std::unique_ptr<Smtp>> TakeSession(int index);
+
+  // Records a failure of the relay, opening the circuit at the threshold.
+  // Requires mutex_.
+  void RecordFailure(Relay &relay);
+
+  void RunHealthChecks();
+
+  const Options options_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Relay>> relays_;
+  std::condition_variable stop_;
+  bool stopping_ = false;
+  std::thread health_thread_;
+};
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_RELAY_SET_H
@@ -0,0 +1,271 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "relay_set.h"
+#include <gtest/gtest.h>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "fake_smtp_server.h"
+#include <atomic>
+#include <thread>
+
+namespace ez {
+namespace smtp {
+namespace {
+
+/** The behavior of a fake relay, shared by its sessions. */
+struct FakeRelay {
+  // Refuses connections and drops existing ones.
+  std::atomic<bool> down{false};
+  // Drops the connection after the message data is written.
+  std::atomic<bool> drop_after_data{false};
+  // The reply to MAIL FROM.
+  std::atomic<int> mail_reply{250};
+  // The reply to the AUTH credentials.
+  std::atomic<int> auth_reply{235};
+  std::chrono::microseconds latency{0};
+  std::atomic<int> messages{0};
+};
+
+class FakeRelayAdapter : public SmtpAdapter {
+public:
+  explicit FakeRelayAdapter(FakeRelay *relay) : relay_(relay) {}
+
+  absl::Status Connect() override {
+    if (relay_->down) {
+      return absl::UnavailableError("Connection refused");
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status EnableTls() override { return absl::OkStatus(); }
+
+  absl::Status Read(int expected_return) override {
+    std::this_thread::sleep_for(relay_->latency);
+    if (relay_->down) {
+      return absl::UnavailableError("Connection reset");
+    }
+    const std::string command = last_command_;
+    last_command_.clear();
+    if (expected_return == 235) {
+      return CheckReply(absl::StrCat(relay_->auth_reply.load(), " Auth"),
+                        expected_return);
+    }
+    if (command == "MAIL") {
+      return CheckReply(absl::StrCat(relay_->mail_reply.load(), " Sender"),
+                        expected_return);
+    }
+    if (command == "DATA_SENT") {
+      if (relay_->drop_after_data) {
+        return absl::UnavailableError("Connection reset");
+      }
+      relay_->messages++;
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status WriteLine(absl::string_view message) override {
+    last_command_ = message.size() > 3 && message.substr(message.size() - 3) ==
+                                              "\r\n."
+                        ? "DATA_SENT"
+                        : std::string(message.substr(0, 4));
+    return absl::OkStatus();
+  }
+
+  std::string Hostname() override { return "TestHost"; }
+  void Disconnect() override {}
+  void EnableLogging() override {}
+
+private:
+  FakeRelay *relay_;
+  std::string last_command_;
+};
+
+Email NewTestEmail() {
+  Email email;
+  email.sender.address = "from@example.com";
+  Recipient &recipient = email.recipients.emplace_back();
+  recipient.address = "to@example.com";
+  email.subject = "Subject";
+  email.body = "Body";
+  return email;
+}
+
+class RelaySetTest : public testing::Test {
+protected:
+  void SetUp() override {
+    RelaySet::Options options;
+    options.failure_threshold = 2;
+    options.health_check_interval = std::chrono::milliseconds(0);
+    NewRelays(options);
+  }
+
+  // Replaces the relay set with one of the primary and secondary relays.
+  void NewRelays(const RelaySet::Options &options) {
+    relays_ = std::make_unique<RelaySet>(options);
+    for (FakeRelay *relay : {&primary_, &secondary_}) {
+      relays_->AddRelay(relay == &primary_ ? "primary" : "secondary",
+                        [relay] {
+                          return std::make_unique<Smtp>(
+                              "username", "password",
+                              std::make_shared<FakeRelayAdapter>(relay));
+                        });
+    }
+  }
+
+  RelaySet::RelayStats Stats(int index) { return relays_->Stats()[index]; }
+
+  FakeRelay primary_;
+  FakeRelay secondary_;
+  std::unique_ptr<RelaySet> relays_;
+};
+
+TEST_F(RelaySetTest, FailsOverWhenRelayIsDown) {
+  primary_.down = true;
+
+  ASSERT_TRUE(relays_->Send(NewTestEmail()).ok());
+
+  EXPECT_EQ(secondary_.messages, 1);
+  EXPECT_EQ(Stats(0).failed, 1);
+  EXPECT_EQ(Stats(0).failed_over, 1);
+  EXPECT_EQ(Stats(1).sent, 1);
+}
+
+TEST_F(RelaySetTest, OpensCircuitAfterConsecutiveFailures) {
+  primary_.down = true;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(relays_->Send(NewTestEmail()).ok());
+  }
+
+  // Skipped once its circuit opened after the second failure.
+  EXPECT_EQ(Stats(0).failed, 2);
+  EXPECT_EQ(Stats(0).state, RelaySet::Open);
+  EXPECT_EQ(secondary_.messages, 4);
+
+  relays_->CheckHealth();
+  EXPECT_EQ(Stats(0).state, RelaySet::Open);
+
+  primary_.down = false;
+  relays_->CheckHealth();
+  EXPECT_EQ(Stats(0).state, RelaySet::Closed);
+  EXPECT_EQ(Stats(0).consecutive_failures, 0);
+}
+
+TEST_F(RelaySetTest, FailsOverWhenLoginFails) {
+  primary_.auth_reply = 535;
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(relays_->Send(NewTestEmail()).ok());
+  }
+
+  EXPECT_EQ(secondary_.messages, 3);
+  EXPECT_EQ(Stats(0).failed, 2);
+  EXPECT_EQ(Stats(0).failed_over, 2);
+  EXPECT_EQ(Stats(0).state, RelaySet::Open);
+  EXPECT_EQ(Stats(1).sent, 3);
+}
+
+TEST_F(RelaySetTest, RetriesTransientReplyOnAnotherRelay) {
+  primary_.mail_reply = 451;
+
+  ASSERT_TRUE(relays_->Send(NewTestEmail()).ok());
+
+  EXPECT_EQ(primary_.messages, 0);
+  EXPECT_EQ(secondary_.messages, 1);
+}
+
+TEST_F(RelaySetTest, DoesNotRetryPermanentReply) {
+  primary_.mail_reply = 550;
+
+  EXPECT_EQ(relays_->Send(NewTestEmail()).code(), absl::StatusCode::kInternal);
+
+  EXPECT_EQ(secondary_.messages, 0);
+  EXPECT_EQ(Stats(0).consecutive_failures, 0);
+}
+
+TEST_F(RelaySetTest, DoesNotResendAfterMessageData) {
+  primary_.drop_after_data = true;
+
+  EXPECT_TRUE(absl::IsUnavailable(relays_->Send(NewTestEmail())));
+
+  EXPECT_EQ(secondary_.messages, 0);
+  EXPECT_EQ(Stats(0).failed_over, 0);
+}
+
+TEST_F(RelaySetTest, PrefersLowerLatencyRelay) {
+  primary_.latency = std::chrono::milliseconds(2);
+  for (int i = 0; i < 20; i++) {
+    ASSERT_TRUE(relays_->Send(NewTestEmail()).ok());
+  }
+
+  // Each relay is tried once to measure its latency.
+  EXPECT_EQ(primary_.messages, 1);
+  EXPECT_EQ(secondary_.messages, 19);
+  EXPECT_GT(Stats(0).latency, Stats(1).latency);
+}
+
+TEST_F(RelaySetTest, RemeasuresStaleLatency) {
+  RelaySet::Options options;
+  options.health_check_interval = std::chrono::milliseconds(0);
+  options.latency_ttl = std::chrono::milliseconds(50);
+  NewRelays(options);
+  primary_.latency = std::chrono::milliseconds(2);
+  ASSERT_TRUE(relays_->Send(NewTestEmail()).ok());
+  ASSERT_TRUE(relays_->Send(NewTestEmail()).ok());
+  ASSERT_EQ(primary_.messages, 1);
+
+  // The primary has recovered, but is only tried again once its measurement
+  // is stale.
+  primary_.latency = std::chrono::microseconds(0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_TRUE(relays_->Send(NewTestEmail()).ok());
+
+  EXPECT_EQ(primary_.messages, 2);
+  EXPECT_LT(Stats(0).latency, std::chrono::milliseconds(2));
+}
+
+TEST(RelaySetServerTest, FailsOverWhenServerStops) {
+  FakeSmtpServer primary;
+  FakeSmtpServer secondary;
+  auto primary_port = primary.Listen();
+  auto secondary_port = secondary.Listen();
+  ASSERT_TRUE(primary_port.ok());
+  ASSERT_TRUE(secondary_port.ok());
+  std::thread primary_thread([&primary] { primary.Serve(); });
+  std::thread secondary_thread([&secondary] { secondary.Serve(); });
+
+  RelaySet::Options options;
+  options.health_check_interval = std::chrono::milliseconds(0);
+  RelaySet relays(options);
+  for (int port : {*primary_port, *secondary_port}) {
+    relays.AddRelay(absl::StrCat("127.0.0.1:", port), [port] {
+      return std::make_unique<Smtp>("127.0.0.1", port, "username",
+                                    "password");
+    });
+  }
+  // Neither relay has been measured, so the primary is tried first.
+  primary.Stop();
+  primary_thread.join();
+  ASSERT_TRUE(relays.Send(NewTestEmail()).ok());
+
+  EXPECT_EQ(primary.messages().size(), 0);
+  EXPECT_EQ(secondary.messages().size(), 1);
+  EXPECT_EQ(relays.Stats()[0].failed_over, 1);
+  secondary.Stop();
+  secondary_thread.join();
+}
+
+} // namespace
+} // namespace smtp
+} // namespace ez
@@ -14,7 +14,9 @@
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
+#include "io_uring_adapter.h"
 #include "smtp.h"
+#include "transcript.h"
 
 ABSL_FLAG(std::string, smtp_server, "", "SMTP server");
 ABSL_FLAG(int, smtp_port, 587, "SMTP port");
@@ -23,11 +25,24 @@ ABSL_FLAG(std::string, smtp_password, "", "SMTP password");
 ABSL_FLAG(std::string, from, "", "Sender email");
 ABSL_FLAG(std::string, to, "", "Recipient email");
 ABSL_FLAG(bool, batch, false, "Batch mode");
+ABSL_FLAG(bool, implicit_tls, false,
+          "Use implicit tls (SMTPS), typically on port 465");
+ABSL_FLAG(bool, io_uring, false,
+          "Use the io_uring transport where supported, otherwise Asio");
+ABSL_FLAG(std::string, record, "",
+          "Records the session to this transcript file for replay");
 
+using ez::smtp::AsioTransport;
 using ez::smtp::Blind;
 using ez::smtp::CarbonCopy;
+using ez::smtp::ImplicitTls;
+using ez::smtp::IoUringTransport;
+using ez::smtp::NewSmtpAdapter;
+using ez::smtp::RecordingSmtpAdapter;
 using ez::smtp::Smtp;
+using ez::smtp::SmtpAdapter;
 using ez::smtp::SmtpAdapterImpl;
+using ez::smtp::StartTls;
 
 absl::Status SendSingle(Smtp &smtp) {
   return smtp.NewEmail()
@@ -65,16 +80,36 @@ absl::Status SendBatch(Smtp &smtp) {
  *  --from="<email>" \
  *  --to="<email>"
  *  --batch=true
+ *
+ * Add --implicit_tls with --server_port=465 for servers that expect tls from
+ * the start, --io_uring to send over the io_uring transport, and
+ * --record=<path> to save the session for ReplaySmtpAdapter.
  */
 int main(int argc, char **argv) {
   absl::ParseCommandLine(argc, argv);
 
-  Smtp smtp(absl::GetFlag(FLAGS_smtp_server), absl::GetFlag(FLAGS_smtp_port),
-            absl::GetFlag(FLAGS_smtp_username),
-            absl::GetFlag(FLAGS_smtp_password));
+  const auto tls_mode =
+      absl::GetFlag(FLAGS_implicit_tls) ? ImplicitTls : StartTls;
+  std::shared_ptr<SmtpAdapter> adapter = NewSmtpAdapter(
+      absl::GetFlag(FLAGS_smtp_server), absl::GetFlag(FLAGS_smtp_port),
+      tls_mode,
+      absl::GetFlag(FLAGS_io_uring) ? IoUringTransport : AsioTransport);
+  std::shared_ptr<RecordingSmtpAdapter> recorder;
+  if (!absl::GetFlag(FLAGS_record).empty()) {
+    recorder = std::make_shared<RecordingSmtpAdapter>(adapter);
+    adapter = recorder;
+  }
+  Smtp smtp(absl::GetFlag(FLAGS_smtp_username),
+            absl::GetFlag(FLAGS_smtp_password), adapter, tls_mode);
   smtp.EnableLogging();
 
   auto status = absl::GetFlag(FLAGS_batch) ? SendBatch(smtp) : SendSingle(smtp);
+  if (recorder != nullptr) {
+    auto saved = recorder->transcript().Save(absl::GetFlag(FLAGS_record));
+    if (!saved.ok()) {
+      std::cerr << saved << std::endl;
+    }
+  }
   if (!status.ok()) {
     std::cerr << status << std::endl;
     return 1;
@@ -0,0 +1,198 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "io_uring_adapter.h"
+#include <gtest/gtest.h>
+
+#include "fake_smtp_server.h"
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ez {
+namespace smtp {
+namespace {
+
+// Enough sessions that per-process state, such as the tls context and each
+// thread's buffers, is small per session, while running in seconds.
+constexpr int kSessions = 2000;
+
+// Fewer sessions send a large message, which is enough to measure them and
+// bounds the memory used if sessions keep the message's buffers.
+constexpr int kSessionsWithMessage = 200;
+constexpr size_t kLargeMessageSize = 256 << 10;
+
+// Generous enough for the tls and socket state of a session, while catching a
+// return to per-connection contexts or tls buffers held while idle. Asio's
+// ssl::stream always holds about 68 KB of buffers per session.
+long MaxBytesPerSession(Transport transport) {
+  return transport == AsioTransport ? 96 << 10 : 32 << 10;
+}
+
+// Returns the resident memory of the process. Free heap memory is returned to
+// the system first, so that only memory in use is counted, not pages freed by
+// earlier messages that the allocator has yet to reuse.
+long ResidentBytes() {
+  malloc_trim(0);
+  std::ifstream statm("/proc/self/statm");
+  long size = 0;
+  long resident = 0;
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+// Returns an email whose body is about the given size, in lines of 78
+// characters.
+Email NewLargeEmail(size_t size) {
+  Email email;
+  email.sender.address = "from@example.com";
+  email.recipients.emplace_back().address = "to@example.com";
+  email.subject = "Large";
+  const std::string line = std::string(76, 'x') + "\r\n";
+  email.body.reserve(size);
+  while (email.body.size() + line.size() <= size) {
+    email.body += line;
+  }
+  return email;
+}
+
+/** Connects many idle, authenticated sessions to a fake server running in a
+ * child process, so that only the memory of the client is measured. The
+ * sessions are connected in another child process, so that memory freed by
+ * earlier tests is not reused. */
+class SessionMemoryTest : public testing::TestWithParam<Transport> {
+public:
+  void SetUp() override {
+    if (GetParam() == IoUringTransport && !IoUringSmtpAdapter::IsSupported()) {
+      GTEST_SKIP() << "io_uring is not supported";
+    }
+    // Each session needs a socket on the client and on the server.
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) != 0 ||
+        limit.rlim_cur < kSessions + 100) {
+      GTEST_SKIP() << "The open file limit is too low for " << kSessions
+                   << " sessions";
+    }
+    // Stopping the server in this process would also shut down the listening
+    // socket it shares with the child, so it is only destroyed afterwards.
+    server_ = std::make_unique<FakeSmtpServer>();
+    server_->set_record_messages(false);
+    auto port = server_->Listen();
+    ASSERT_TRUE(port.ok());
+    port_ = *port;
+    server_pid_ = fork();
+    if (server_pid_ == 0) {
+      server_->Serve();
+      _exit(0);
+    }
+  }
+
+  void TearDown() override {
+    if (server_pid_ > 0) {
+      kill(server_pid_, SIGKILL);
+      waitpid(server_pid_, nullptr, 0);
+    }
+  }
+
+protected:
+  // Returns the resident memory per session once the sessions are connected,
+  // each having sent an email of the given size if it is not 0. Returns -1 if
+  // not every session could connect and send.
+  long BytesPerSession(int num_sessions, size_t message_size) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+      return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      auto context = std::make_shared<SmtpContext>();
+      const Email email = NewLargeEmail(message_size);
+      std::vector<std::unique_ptr<Smtp>> sessions;
+      sessions.reserve(num_sessions);
+      // The first session is not measured, as it also grows state shared by
+      // every session, such as the thread's message data buffer.
+      long before = 0;
+      long bytes_per_session = -1;
+      for (int i = 0; i < num_sessions; i++) {
+        sessions.push_back(std::make_unique<Smtp>(
+            "username", "password",
+            NewSmtpAdapter("127.0.0.1", port_, StartTls, GetParam(),
+                           context)));
+        auto status = sessions.back()->Connect();
+        if (status.ok() && message_size > 0) {
+          status = sessions.back()->NewEmail(email).SendBatch();
+          // The builder keeps the email until the next one is started.
+          sessions.back()->NewEmail();
+        }
+        if (!status.ok()) {
+          std::cerr << i << ": " << status << std::endl;
+          break;
+        }
+        if (i == 0) {
+          before = ResidentBytes();
+        } else if (i == num_sessions - 1) {
+          bytes_per_session = (ResidentBytes() - before) / (num_sessions - 1);
+        }
+      }
+      write(pipe_fds[1], &bytes_per_session, sizeof(bytes_per_session));
+      _exit(0);
+    }
+    close(pipe_fds[1]);
+    long bytes_per_session = -1;
+    read(pipe_fds[0], &bytes_per_session, sizeof(bytes_per_session));
+    close(pipe_fds[0]);
+    waitpid(pid, nullptr, 0);
+    return bytes_per_session;
+  }
+
+  std::unique_ptr<FakeSmtpServer> server_;
+  int port_ = 0;
+  pid_t server_pid_ = 0;
+};
+
+TEST_P(SessionMemoryTest, IdleSessions) {
+  const long bytes_per_session = BytesPerSession(kSessions, 0);
+  ASSERT_GT(bytes_per_session, 0) << "Unable to connect every session";
+
+  std::cout << "RSS per idle session: " << bytes_per_session << " bytes"
+            << std::endl;
+  RecordProperty("rss_bytes_per_session", bytes_per_session);
+  EXPECT_LT(bytes_per_session, MaxBytesPerSession(GetParam()));
+}
+
+// Sessions must not keep buffers sized for the largest message they sent.
+TEST_P(SessionMemoryTest, IdleSessionsAfterLargeMessage) {
+  const long bytes_per_session =
+      BytesPerSession(kSessionsWithMessage, kLargeMessageSize);
+  ASSERT_GT(bytes_per_session, 0) << "Unable to send from every session";
+
+  std::cout << "RSS per idle session after a "
+            << (kLargeMessageSize >> 10) << " KB message: "
+            << bytes_per_session << " bytes" << std::endl;
+  RecordProperty("rss_bytes_per_session_after_message", bytes_per_session);
+  EXPECT_LT(bytes_per_session, MaxBytesPerSession(GetParam()));
+}
+
+INSTANTIATE_TEST_SUITE_P(Transports, SessionMemoryTest,
+                         testing::Values(AsioTransport, IoUringTransport));
+
+} // namespace
+} // namespace smtp
+} // namespace ez
@@ -0,0 +1,188 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sharded_sender.h"
+
+#include "absl/status/status.h"
+#include "pooled_session.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ez {
+namespace smtp {
+namespace {
+
+void PinToCore(int index) {
+#ifdef __linux__
+  unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(index % cores, &cpu_set);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#endif
+}
+
+} // namespace
+
+ShardedSender::ShardedSender(SmtpFactory factory, const Options &options)
+    : factory_(std::move(factory)), options_(options) {
+  int num_shards = options_.num_shards;
+  if (num_shards <= 0) {
+    num_shards = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (int i = 0; i < num_shards; i++) {
+    shards_.emplace_back(new Shard());
+  }
+  for (int i = 0; i < num_shards; i++) {
+    shards_[i]->thread = std::thread(&ShardedSender::Run, this, i);
+  }
+}
+
+void ShardedSender::Submit(Email email, Callback done) {
+  pending_.fetch_add(1);
+  if (!accepting_.load()) {
+    pending_.fetch_sub(1);
+    if (done) {
+      done(absl::FailedPreconditionError("The sender has been shut down"));
+    }
+    return;
+  }
+  Shard &shard = *shards_[next_shard_.fetch_add(1, std::memory_order_relaxed) %
+                          shards_.size()];
+  shard.pending.fetch_add(1);
+  shard.inbox.Push(Job{std::move(email), std::move(done)});
+  if (shard.sleeping.load()) {
+    Wake(shard);
+    return;
+  }
+  // The shard is busy, so wake an idle one to steal the email.
+  for (auto &other : shards_) {
+    if (other->sleeping.load()) {
+      Wake(*other);
+      return;
+    }
+  }
+}
+
+void ShardedSender::Shutdown() {
+  std::lock_guard<std::mutex> lock(shutdown_mutex_);
+  if (stopping_.load()) {
+    return;
+  }
+  accepting_.store(false);
+  stopping_.store(true);
+  for (auto &shard : shards_) {
+    Wake(*shard);
+  }
+  for (auto &shard : shards_) {
+    shard->thread.join();
+  }
+}
+
+std::vector<ShardedSender::ShardStats> ShardedSender::Stats() const {
+  std::vector<ShardStats> stats;
+  for (const auto &shard : shards_) {
+    ShardStats &shard_stats = stats.emplace_back();
+    shard_stats.sent = shard->sent.load();
+    shard_stats.failed = shard->failed.load();
+    shard_stats.stolen = shard->stolen.load();
+  }
+  return stats;
+}
+
+void ShardedSender::Run(int index) {
+  if (options_.pin_threads) {
+    PinToCore(index);
+  }
+  Shard &shard = *shards_[index];
+  shard.smtp = factory_();
+  std::vector<Job> jobs;
+  while (true) {
+    jobs.clear();
+    if (TakeJobs(shard, 1, &jobs) == 0) {
+      shard.stolen += Steal(index, &jobs);
+    }
+    for (auto &job : jobs) {
+      SendJob(shard, job);
+    }
+    if (!jobs.empty()) {
+      continue;
+    }
+    if (stopping_.load() && pending_.load() == 0) {
+      break;
+    }
+    KeepAlivePooled(*shard.smtp);
+    std::unique_lock<std::mutex> lock(shard.wake_mutex);
+    shard.sleeping.store(true);
+    if (shard.pending.load() == 0 && !stopping_.load()) {
+      shard.wake.wait_for(lock, options_.idle_wait);
+    }
+    shard.sleeping.store(false);
+  }
+  shard.smtp->Disconnect().IgnoreError();
+}
+
+int ShardedSender::TakeJobs(Shard &shard, int max_jobs,
+                            std::vector<Job> *jobs) {
+  std::lock_guard<std::mutex> lock(shard.consumer_mutex);
+  int taken = 0;
+  Job job;
+  while (taken < max_jobs && shard.inbox.Pop(&job)) {
+    shard.pending.fetch_sub(1);
+    jobs->push_back(std::move(job));
+    taken++;
+  }
+  return taken;
+}
+
+int ShardedSender::Steal(int thief, std::vector<Job> *jobs) {
+  Shard *victim = nullptr;
+  int64_t most_pending = 0;
+  for (int i = 0; i < num_shards(); i++) {
+    int64_t pending = shards_[i]->pending.load();
+    if (i != thief && pending > most_pending) {
+      victim = shards_[i].get();
+      most_pending = pending;
+    }
+  }
+  if (victim == nullptr) {
+    return 0;
+  }
+  return TakeJobs(*victim, static_cast<int>((most_pending + 1) / 2), jobs);
+}
+
+void ShardedSender::SendJob(Shard &shard, Job &job) {
+  const absl::Status status = SendPooled(*shard.smtp, job.email);
+  if (status.ok()) {
+    shard.sent++;
+  } else {
+    shard.failed++;
+  }
+  if (job.done) {
+    job.done(status);
+  }
+  pending_.fetch_sub(1);
+}
+
+void ShardedSender::Wake(Shard &shard) {
+  std::lock_guard<std::mutex> lock(shard.wake_mutex);
+  shard.wake.notify_one();
+}
+
+} // namespace smtp
+} // namespace ez
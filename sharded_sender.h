@@ -0,0 +1,145 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_SHARDED_SENDER_H
+#define EZ_SHARDED_SENDER_H
+
+#include "absl/status/status.h"
+#include "mpsc_queue.h"
+#include "smtp.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ez {
+namespace smtp {
+
+/** Sends queued emails from a pool of threads, one per core by default.
+ *
+ * Each shard runs its own thread and owns its own Smtp session, which it
+ * keeps connected in batch mode. Emails are submitted through a lock-free
+ * queue per shard, and a shard with nothing to do steals queued emails from
+ * the busiest shard, so a slow session does not hold up the rest.
+ *
+ *   ShardedSender sender([] {
+ *     return std::make_unique<Smtp>("smtp.sendgrid.net", 587, "username",
+ *                                   "password");
+ *   });
+ *   sender.Submit(email, [](absl::Status status) {
+ *     if (!status.ok()) {
+ *       std::cerr << status << std::endl;
+ *     }
+ *   });
+ *   sender.Shutdown();
+ */
+class ShardedSender {
+public:
+  typedef std::function<std::unique_ptr<Smtp>()> SmtpFactory;
+  typedef std::function<void(absl::Status)> Callback;
+
+  struct Options {
+    // Number of shards, or 0 for one per core.
+    int num_shards = 0;
+
+    // Pins each shard's thread to a core (Linux only). Off by default, as it
+    // overrides the application's own scheduling and a container's cpuset.
+    bool pin_threads = false;
+
+    // How long an idle shard sleeps before looking for work to steal and
+    // keeping its session alive.
+    std::chrono::milliseconds idle_wait = std::chrono::milliseconds(10);
+  };
+
+  struct ShardStats {
+    uint64_t sent = 0;
+    uint64_t failed = 0;
+    uint64_t stolen = 0;
+  };
+
+  explicit ShardedSender(SmtpFactory factory) : ShardedSender(factory, {}) {}
+
+  ShardedSender(SmtpFactory factory, const Options &options);
+
+  /** Sends any queued emails, then stops the shards. */
+  ~ShardedSender() { Shutdown(); }
+
+  ShardedSender(const ShardedSender &) = delete;
+  ShardedSender &operator=(const ShardedSender &) = delete;
+
+  /** Queues an email to be sent. May be called from any thread. The callback
+   * is invoked from a shard thread once the email has been sent or failed. */
+  void Submit(Email email, Callback done = nullptr);
+
+  /** Waits for all queued emails to be sent, disconnects and stops the
+   * shards. Emails submitted afterwards fail immediately. */
+  void Shutdown();
+
+  int num_shards() const { return static_cast<int>(shards_.size()); }
+
+  /** Returns the number of emails each shard has handled. */
+  std::vector<ShardStats> Stats() const;
+
+private:
+  struct Job {
+    Email email;
+    Callback done;
+  };
+
+  struct Shard {
+    MpscQueue<Job> inbox;
+    // Serializes the consumer side of the inbox between the owner and
+    // stealing shards.
+    std::mutex consumer_mutex;
+    std::atomic<int64_t> pending{0};
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::atomic<bool> sleeping{false};
+    std::unique_ptr<Smtp> smtp;
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> stolen{0};
+    std::thread thread;
+  };
+
+  void Run(int index);
+
+  // Pops up to max_jobs from the shard's inbox.
+  int TakeJobs(Shard &shard, int max_jobs, std::vector<Job> *jobs);
+
+  // Steals about half of the queued jobs of the busiest other shard.
+  int Steal(int thief, std::vector<Job> *jobs);
+
+  void SendJob(Shard &shard, Job &job);
+
+  void Wake(Shard &shard);
+
+  SmtpFactory factory_;
+  Options options_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<uint64_t> next_shard_{0};
+  std::atomic<int64_t> pending_{0};
+  std::atomic<bool> accepting_{true};
+  std::atomic<bool> stopping_{false};
+  std::mutex shutdown_mutex_;
+};
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_SHARDED_SENDER_H
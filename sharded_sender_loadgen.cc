@@ -0,0 +1,95 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/str_format.h"
+#include "fake_smtp_adapter.h"
+#include "sharded_sender.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+ABSL_FLAG(int, emails, 20000, "Emails to send per run");
+ABSL_FLAG(int, max_shards, 0, "Largest shard count to measure, 0 for cores");
+ABSL_FLAG(int, producers, 4, "Application threads submitting emails");
+ABSL_FLAG(int, latency_us, 0, "Simulated server latency per reply");
+
+using ez::smtp::Email;
+using ez::smtp::FakeSmtpAdapter;
+using ez::smtp::NewTestEmail;
+using ez::smtp::ShardedSender;
+using ez::smtp::Smtp;
+
+double EmailsPerSecond(int num_shards) {
+  const int emails = absl::GetFlag(FLAGS_emails);
+  const int producers = absl::GetFlag(FLAGS_producers);
+  const std::chrono::microseconds latency(absl::GetFlag(FLAGS_latency_us));
+  const Email email = NewTestEmail("Load test", std::string(2048, 'x'));
+
+  ShardedSender::Options options;
+  options.num_shards = num_shards;
+  options.pin_threads = true;
+  auto start = std::chrono::steady_clock::now();
+  {
+    ShardedSender sender(
+        [latency] {
+          return std::make_unique<Smtp>(
+              "username", "password",
+              std::make_shared<FakeSmtpAdapter>(latency));
+        },
+        options);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+      threads.emplace_back([&, p] {
+        for (int i = p; i < emails; i += producers) {
+          sender.Submit(email);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    sender.Shutdown();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return emails / elapsed.count();
+}
+
+/** Prints the sharded sender's throughput scaling curve from 1 to N shards
+ * against an in-memory server. Example usage:
+ *
+ * bazel run -c opt :sharded_sender_loadgen -- --emails=100000 --latency_us=50
+ */
+int main(int argc, char **argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  int max_shards = absl::GetFlag(FLAGS_max_shards);
+  if (max_shards <= 0) {
+    max_shards = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::cout << "shards\temails/s\tspeedup" << std::endl;
+  double baseline = 0;
+  for (int shards = 1; shards <= max_shards; shards++) {
+    double rate = EmailsPerSecond(shards);
+    if (shards == 1) {
+      baseline = rate;
+    }
+    std::cout << absl::StrFormat("%d\t%.0f\t%.2fx", shards, rate,
+                                 rate / baseline)
+              << std::endl;
+  }
+  return 0;
+}
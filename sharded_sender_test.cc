@@ -0,0 +1,143 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sharded_sender.h"
+#include <gtest/gtest.h>
+
+#include "absl/status/status.h"
+#include "fake_smtp_adapter.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace ez {
+namespace smtp {
+namespace {
+
+/** Counts completed sends. */
+class Completions {
+public:
+  ShardedSender::Callback Callback() {
+    return [this](absl::Status status) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (status.ok()) {
+        ok_++;
+      }
+      done_++;
+      condition_.notify_all();
+    };
+  }
+
+  void WaitFor(int count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [&] { return done_ >= count; });
+  }
+
+  int ok() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ok_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  int done_ = 0;
+  int ok_ = 0;
+};
+
+ShardedSender::Options TestOptions(int num_shards) {
+  ShardedSender::Options options;
+  options.num_shards = num_shards;
+  options.pin_threads = false;
+  return options;
+}
+
+std::unique_ptr<Smtp> NewFakeSmtp(Gate *gate = nullptr) {
+  return std::make_unique<Smtp>("username", "password",
+                                std::make_shared<FakeSmtpAdapter>(gate));
+}
+
+TEST(ShardedSenderTest, SendsAllEmails) {
+  Completions completions;
+  ShardedSender sender([] { return NewFakeSmtp(); }, TestOptions(4));
+  for (int i = 0; i < 100; i++) {
+    sender.Submit(NewTestEmail("Subject"), completions.Callback());
+  }
+  sender.Shutdown();
+
+  ASSERT_EQ(completions.ok(), 100);
+  uint64_t sent = 0;
+  for (const auto &stats : sender.Stats()) {
+    sent += stats.sent;
+  }
+  ASSERT_EQ(sent, 100);
+}
+
+TEST(ShardedSenderTest, IdleShardStealsFromBlockedShard) {
+  Gate gate;
+  Completions completions;
+  ShardedSender sender([&gate] { return NewFakeSmtp(&gate); },
+                       TestOptions(2));
+  sender.Submit(NewTestEmail("block"), completions.Callback());
+  for (int i = 0; i < 10; i++) {
+    sender.Submit(NewTestEmail("Subject"), completions.Callback());
+  }
+
+  // Half of these were queued on the blocked shard, so they can only
+  // complete if the other shard steals them.
+  completions.WaitFor(10);
+  gate.Open();
+  sender.Shutdown();
+
+  ASSERT_EQ(completions.ok(), 11);
+  uint64_t stolen = 0;
+  for (const auto &stats : sender.Stats()) {
+    stolen += stats.stolen;
+  }
+  ASSERT_GE(stolen, 5);
+}
+
+TEST(ShardedSenderTest, SurvivesFailedReconnect) {
+  std::atomic<int> misuses{0};
+  Completions completions;
+  ShardedSender sender(
+      [&misuses] {
+        return std::make_unique<Smtp>(
+            "username", "password",
+            std::make_shared<RefusingSmtpAdapter>(&misuses));
+      },
+      TestOptions(1));
+  for (int i = 0; i < 2; i++) {
+    sender.Submit(NewTestEmail("Subject"), completions.Callback());
+  }
+  sender.Shutdown();
+
+  EXPECT_EQ(completions.ok(), 0);
+  EXPECT_EQ(sender.Stats()[0].failed, 2);
+  EXPECT_EQ(misuses, 0);
+}
+
+TEST(ShardedSenderTest, SubmitAfterShutdownFails) {
+  ShardedSender sender([] { return NewFakeSmtp(); }, TestOptions(1));
+  sender.Shutdown();
+
+  absl::Status result;
+  sender.Submit(NewTestEmail("Subject"),
+                [&](absl::Status status) { result = status; });
+  ASSERT_TRUE(absl::IsFailedPrecondition(result));
+}
+
+} // namespace
+} // namespace smtp
+} // namespace ez
@@ -15,13 +15,16 @@
 #include "smtp.h"
 
 #include "absl/status/status.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_cat.h"
+#include "mime_header.h"
 #include "status_macros.h"
 #include <boost/archive/iterators/base64_from_binary.hpp>
 #include <boost/archive/iterators/binary_from_base64.hpp>
 #include <boost/archive/iterators/remove_whitespace.hpp>
 #include <boost/archive/iterators/transform_width.hpp>
+#include <array>
 #include <boost/array.hpp>
 #include <iostream>
 
@@ -31,35 +34,80 @@ namespace ez {
 namespace smtp {
 namespace {
 
+// Lines up to this size are copied into the adapter's output buffer, to be
+// written together with their CRLF. Longer lines, i.e. message data, are
+// written from the caller's buffer, so the output buffer stays small.
+constexpr size_t kMaxCoalescedLine = 1 << 10;
+
+// Body capacity kept by a session between emails. A larger body is freed by
+// Reset, so that idle sessions stay small.
+constexpr size_t kRetainedBodyCapacity = 8 << 10;
+
+// Message data capacity kept by each sending thread between emails. Emails up
+// to this size are encoded without allocating; the buffer of a larger one is
+// freed once it has been sent.
+constexpr size_t kRetainedDataCapacity = 1 << 20;
+
+// Body bytes appended to the message data before hashing them for DKIM, so
+// that the body is hashed from cache.
+constexpr size_t kBodyHashChunk = 16 << 10;
+
+// The message data of the email being sent by this thread. It belongs to the
+// thread rather than the session, since a session only needs it while
+// sending, so idle sessions stay small however large their last email was.
+std::string &MessageData() {
+  thread_local std::string data;
+  return data;
+}
+
+// An SMTP command taking one argument, split around the argument at compile
+// time.
+struct Command {
+  absl::string_view prefix;
+  absl::string_view suffix;
+};
+
+constexpr Command kHelo{"HELO ", ""};
+constexpr Command kMailFrom{"MAIL FROM: <", ">"};
+constexpr Command kRcptTo{"RCPT TO: <", ">"};
+
+// Encodes the command into the buffer, reusing its capacity, and returns it.
+absl::string_view Encode(const Command &command, absl::string_view argument,
+                         std::string *buffer) {
+  buffer->assign(command.prefix.data(), command.prefix.size());
+  buffer->append(argument.data(), argument.size());
+  buffer->append(command.suffix.data(), command.suffix.size());
+  return *buffer;
+}
+
+// The mailboxes vector is scratch space, reused between messages.
 void WriteRecipient(absl::string_view field, absl::string_view address,
-                    absl::string_view name, std::stringstream &output) {
-  output << field << ": " << address;
-  if (name.size() > 0) {
-    output << " <" << name << ">";
-  }
-  output << "\r\n";
+                    absl::string_view name, std::vector<Mailbox> *mailboxes,
+                    std::string *output) {
+  mailboxes->assign(1, Mailbox{address, name});
+  AppendAddressHeader(field, *mailboxes, output);
 }
 
-void WriteRecipients(const std::vector<Recipient> recipients,
+void WriteRecipients(const std::vector<Recipient> &recipients,
                      absl::string_view field, const int recipient_type,
-                     std::stringstream &output) {
-  bool started = false;
+                     std::vector<Mailbox> *mailboxes, std::string *output) {
+  mailboxes->clear();
   for (auto it = recipients.begin(); it != recipients.end(); it++) {
-    if (it->recipient_type != recipient_type) {
-      continue;
-    }
-    if (started) {
-      output << ", ";
-    } else {
-      output << field << ": ";
-      started = true;
+    if (it->recipient_type == recipient_type) {
+      mailboxes->push_back(Mailbox{it->address, it->name});
     }
-    if (it->name.size() > 0)
-      output << it->name << " <" << it->address << ">";
-    else
-      output << it->address;
-    output << "\r\n";
   }
+  AppendAddressHeader(field, *mailboxes, output);
+}
+
+// Addresses are written as is to SMTP commands and header fields, so they
+// must not be able to end either early.
+absl::Status CheckAddress(absl::string_view address) {
+  if (address.find_first_of("\r\n<>") != absl::string_view::npos) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid email address: ", address));
+  }
+  return absl::OkStatus();
 }
 
 std::string Base64Encode(const std::string &data) {
@@ -77,13 +125,17 @@ std::string Base64Encode(const std::string &data) {
   return result;
 }
 
-absl::Status StartTls(SmtpAdapter &adapter, absl::string_view username,
-                      absl::string_view password) {
-  RETURN_IF_ERROR(adapter.Read(220));
-  RETURN_IF_ERROR(adapter.WriteLine("STARTTLS"));
+absl::Status Login(SmtpAdapter &adapter, TlsMode tls_mode,
+                   absl::string_view username, absl::string_view password,
+                   std::string *command) {
   RETURN_IF_ERROR(adapter.Read(220));
-  RETURN_IF_ERROR(adapter.EnableTls());
-  RETURN_IF_ERROR(adapter.WriteLine(absl::StrCat("HELO ", adapter.Hostname())));
+  if (tls_mode == StartTls) {
+    RETURN_IF_ERROR(adapter.WriteLine("STARTTLS"));
+    RETURN_IF_ERROR(adapter.Read(220));
+    RETURN_IF_ERROR(adapter.EnableTls());
+  }
+  RETURN_IF_ERROR(
+      adapter.WriteLine(Encode(kHelo, adapter.Hostname(), command)));
   RETURN_IF_ERROR(adapter.Read(250));
   RETURN_IF_ERROR(adapter.WriteLine("AUTH PLAIN"));
   RETURN_IF_ERROR(adapter.Read(334));
@@ -94,10 +146,11 @@ absl::Status StartTls(SmtpAdapter &adapter, absl::string_view username,
   return absl::OkStatus();
 }
 
-absl::Status Connect(SmtpAdapter &adapter, absl::string_view username,
-                     absl::string_view password) {
+absl::Status Connect(SmtpAdapter &adapter, TlsMode tls_mode,
+                     absl::string_view username, absl::string_view password,
+                     std::string *command) {
   RETURN_IF_ERROR(adapter.Connect());
-  auto status = StartTls(adapter, username, password);
+  auto status = Login(adapter, tls_mode, username, password, command);
   if (!status.ok()) {
     adapter.Disconnect();
   }
@@ -113,12 +166,44 @@ absl::Status Quit(SmtpAdapter &adapter) {
   return status;
 }
 
+absl::Status Noop(SmtpAdapter &adapter) {
+  RETURN_IF_ERROR(adapter.WriteLine("NOOP"));
+  return adapter.Read(250);
+}
+
 } // namespace
 
+absl::Status CheckReply(absl::string_view reply, const int expected_return) {
+  int return_value = 0;
+  for (size_t i = 0; i < 3 && i < reply.size() && absl::ascii_isdigit(reply[i]);
+       i++) {
+    return_value = return_value * 10 + (reply[i] - '0');
+  }
+  if (return_value == 421 && expected_return != 421) {
+    return absl::UnavailableError("The server is shutting down (421)");
+  }
+  if (return_value != expected_return) {
+    const std::string message = absl::StrFormat(
+        "Expected status %d, received %d", expected_return, return_value);
+    // 4xx replies are transient failures, which may succeed if retried.
+    if (return_value >= 400 && return_value < 500) {
+      return absl::AbortedError(message);
+    }
+    return absl::InternalError(message);
+  }
+  return absl::OkStatus();
+}
+
+std::shared_ptr<SmtpContext> SmtpContext::Default() {
+  static const auto context = std::make_shared<SmtpContext>();
+  return context;
+}
+
 absl::Status SmtpAdapterImpl::Connect() {
-  socket_.reset(new SslSocket(io_service_, ssl_context_));
+  socket_.reset(
+      new SslSocket(context_->io_service(), context_->ssl_context()));
   tcp::resolver::query query(hostname_, std::to_string(port_));
-  tcp::resolver resolver(io_service_);
+  tcp::resolver resolver(context_->io_service());
   tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
   boost::system::error_code error = boost::asio::error::host_not_found;
   tcp::resolver::iterator end;
@@ -129,91 +214,249 @@ absl::Status SmtpAdapterImpl::Connect() {
   if (error) {
     return absl::UnavailableError(error.message());
   }
+  if (tls_mode_ == ImplicitTls) {
+    auto status = EnableTls();
+    if (!status.ok()) {
+      Disconnect();
+      return status;
+    }
+  }
   return absl::OkStatus();
 }
 
 absl::Status SmtpAdapterImpl::Read(const int expected_return) {
+  reply_.clear();
+  if (!socket_) {
+    return absl::FailedPreconditionError("Not connected");
+  }
   std::size_t bytes_received;
   boost::array<char, 256> buffer;
+  boost::system::error_code error;
   if (enable_tls_)
-    bytes_received = socket_->read_some(boost::asio::buffer(buffer));
+    bytes_received = socket_->read_some(boost::asio::buffer(buffer), error);
   else
-    bytes_received = socket_->next_layer().receive(boost::asio::buffer(buffer));
-  if (bytes_received == 0) {
-    return absl::InternalError("The server closed the connection");
+    bytes_received =
+        socket_->next_layer().receive(boost::asio::buffer(buffer), 0, error);
+  if (bytes_received == 0 || error == boost::asio::error::eof) {
+    return absl::UnavailableError("The server closed the connection");
+  }
+  if (error) {
+    return absl::UnavailableError(error.message());
   }
 
-  std::string response;
-  std::copy(buffer.begin(), buffer.begin() + bytes_received,
-            std::back_inserter(response));
+  reply_.assign(buffer.data(), bytes_received);
   if (log_) {
-    std::cout << response;
+    std::cout << reply_;
   }
 
-  int return_value = atoi(response.substr(0, 3).c_str());
-  if (return_value != expected_return) {
-    return absl::InternalError(absl::StrFormat(
-        "Expected status %d, received %d", expected_return, return_value));
-  }
-  return absl::OkStatus();
+  return CheckReply(reply_, expected_return);
 }
 
 absl::Status SmtpAdapterImpl::WriteLine(absl::string_view message) {
+  if (!socket_) {
+    return absl::FailedPreconditionError("Not connected");
+  }
   boost::system::error_code error;
-  const std::string line = std::string(absl::StrCat(message, "\r\n"));
-  auto buffer = boost::asio::buffer(line);
-  if (enable_tls_)
-    socket_->write_some(buffer, error);
-  else
-    socket_->next_layer().write_some(buffer, error);
+  auto write = [&](const auto &buffers) {
+    if (enable_tls_)
+      boost::asio::write(*socket_, buffers, error);
+    else
+      boost::asio::write(socket_->next_layer(), buffers, error);
+  };
+  if (message.size() + 2 <= kMaxCoalescedLine) {
+    // Commands are written with their CRLF in one piece, from a buffer that
+    // keeps its capacity between lines.
+    output_.assign(message.data(), message.size());
+    output_.append("\r\n");
+    write(boost::asio::buffer(output_));
+  } else {
+    const std::array<boost::asio::const_buffer, 2> buffers = {
+        boost::asio::buffer(message.data(), message.size()),
+        boost::asio::buffer("\r\n", 2)};
+    write(buffers);
+  }
   if (log_) {
-    std::cout << line;
+    std::cout << message << "\r\n";
+  }
+  return error ? absl::UnavailableError(error.message()) : absl::OkStatus();
+}
+
+absl::Status Session::Connect() {
+  RETURN_IF_ERROR(ez::smtp::Connect(adapter_, tls_mode_, username_, password_,
+                                    &command_));
+  connected_ = true;
+  Touch();
+  return absl::OkStatus();
+}
+
+absl::Status Session::Disconnect() {
+  // The adapter was already disconnected, e.g. by a failed reconnect.
+  if (!connected_) {
+    return absl::OkStatus();
+  }
+  connected_ = false;
+  return Quit(adapter_);
+}
+
+void Session::Close() {
+  connected_ = false;
+  adapter_.Disconnect();
+}
+
+absl::Status Session::Reconnect() {
+  Close();
+  return Connect();
+}
+
+absl::Status Session::KeepAlive() {
+  if (!connected_ || Clock::now() - last_activity_ < keepalive_interval_) {
+    return absl::OkStatus();
+  }
+  // Any failure, e.g. a 4xx reply or an I/O error, leaves the connection in
+  // an unknown state, so it is replaced.
+  if (!Noop(adapter_).ok()) {
+    return Reconnect();
+  }
+  Touch();
+  return absl::OkStatus();
+}
+
+BuilderImpl &BuilderImpl::Reset() {
+  subject_ = "";
+  if (body_.capacity() > kRetainedBodyCapacity) {
+    std::string().swap(body_);
+  } else {
+    body_ = "";
   }
-  return error ? absl::InternalError(error.message()) : absl::OkStatus();
+  sender_.address = "";
+  sender_.name = "";
+  content_type_ = "";
+  recipients_.clear();
+  return *this;
 }
 
 absl::Status BuilderImpl::Send() {
-  RETURN_IF_ERROR(Connect(adapter_, username_, password_));
+  RETURN_IF_ERROR(session_.Connect());
   auto status = SendBatch();
   if (!status.ok()) {
-    adapter_.Disconnect();
+    session_.Close();
     return status;
   }
-  return Quit(adapter_);
+  return session_.Disconnect();
 }
 
 absl::Status BuilderImpl::SendBatch() {
+  data_sent_ = false;
+  std::string &data = MessageData();
+  absl::Status status = EncodeData(&data);
+  if (status.ok()) {
+    status = session_.KeepAlive();
+  }
+  if (status.ok()) {
+    status = SendMessage(data, &data_sent_);
+    // The server never acknowledged the message, so it is safe to resend it
+    // over a new connection.
+    if (absl::IsUnavailable(status) && !data_sent_ && session_.connected()) {
+      status = session_.Reconnect();
+      if (status.ok()) {
+        status = SendMessage(data, &data_sent_);
+      }
+    }
+  }
+  if (status.ok()) {
+    session_.Touch();
+  }
+  if (data.capacity() > kRetainedDataCapacity) {
+    std::string().swap(data);
+  }
+  return status;
+}
+
+absl::Status BuilderImpl::EncodeData(std::string *data) {
+  RETURN_IF_ERROR(CheckAddress(sender_.address));
+  for (const Recipient &recipient : recipients_) {
+    RETURN_IF_ERROR(CheckAddress(recipient.address));
+  }
+  if (content_type_.find_first_of("\r\n") != std::string::npos) {
+    return absl::InvalidArgumentError("Invalid content type");
+  }
+
+  data->clear();
+  WriteRecipient("From", sender_.address, sender_.name, &mailboxes_, data);
+  WriteRecipients(recipients_, "To", Primary, &mailboxes_, data);
+  WriteRecipients(recipients_, "Cc", CarbonCopy, &mailboxes_, data);
+  WriteRecipients(recipients_, "Bcc", Blind, &mailboxes_, data);
+  if (content_type_ != "") {
+    absl::StrAppend(data, "MIME-Version: 1.0\r\n",
+                    "Content-Type: ", content_type_, "\r\n");
+  }
+  AppendUnstructuredHeader("Subject", subject_, data);
+
+  const size_t at = sender_.address.rfind('@');
+  const absl::string_view domain =
+      at == std::string::npos
+          ? absl::string_view()
+          : absl::string_view(sender_.address).substr(at + 1);
+  dkim_signature_.clear();
+  if (!dkim_signer_ || !dkim_signer_->HasKey(domain)) {
+    absl::StrAppend(data, "\r\n", body_, "\r\n.");
+    return absl::OkStatus();
+  }
+
+  // The body is hashed as it is appended, a chunk at a time while the chunk
+  // is in cache.
+  const size_t headers_size = data->size();
+  data->reserve(headers_size + body_.size() + 5);
+  data->append("\r\n");
+  DkimBodyHash body_hash;
+  const absl::string_view body = body_;
+  for (size_t start = 0; start < body.size(); start += kBodyHashChunk) {
+    const absl::string_view chunk = body.substr(start, kBodyHashChunk);
+    data->append(chunk.data(), chunk.size());
+    body_hash.Update(chunk);
+  }
+  // The body is sent followed by a line break, then the terminating dot.
+  body_hash.Update("\r\n");
+  data->append("\r\n.");
+  auto signed_header = dkim_signer_->Sign(
+      domain, absl::string_view(*data).substr(0, headers_size),
+      body_hash.Final());
+  if (!signed_header.ok()) {
+    return signed_header.status();
+  }
+  dkim_signature_ = *std::move(signed_header);
+  return absl::OkStatus();
+}
+
+absl::Status BuilderImpl::SendMessage(absl::string_view data,
+                                      bool *data_sent) {
+  SmtpAdapter &adapter = session_.adapter();
+  std::string *command = session_.command_buffer();
   RETURN_IF_ERROR(
-      adapter_.WriteLine(absl::StrCat("MAIL FROM: <", sender_.address, ">")));
-  RETURN_IF_ERROR(adapter_.Read(250));
+      adapter.WriteLine(Encode(kMailFrom, sender_.address, command)));
+  RETURN_IF_ERROR(adapter.Read(250));
   for (auto it = recipients_.begin(); it != recipients_.end(); it++) {
     RETURN_IF_ERROR(
-        adapter_.WriteLine(absl::StrCat("RCPT TO: <", it->address, ">")));
-    RETURN_IF_ERROR(adapter_.Read(250));
-  }
-  RETURN_IF_ERROR(adapter_.WriteLine("DATA"));
-  RETURN_IF_ERROR(adapter_.Read(354));
-  std::stringstream data;
-  WriteRecipient("From", sender_.address, sender_.name, data);
-  WriteRecipients(recipients_, "To", Primary, data);
-  WriteRecipients(recipients_, "Cc", CarbonCopy, data);
-  WriteRecipients(recipients_, "Bcc", Blind, data);
-  if (content_type_ != "") {
-    data << "MIME-Version: 1.0\r\n";
-    data << "Content-Type: " << content_type_ << "\r\n";
+        adapter.WriteLine(Encode(kRcptTo, it->address, command)));
+    RETURN_IF_ERROR(adapter.Read(250));
   }
-  data << "Subject: " << subject_ << "\r\n\r\n";
-  data << body_ << "\r\n.";
-  RETURN_IF_ERROR(adapter_.WriteLine(data.str()));
-  RETURN_IF_ERROR(adapter_.Read(250));
+  RETURN_IF_ERROR(adapter.WriteLine("DATA"));
+  RETURN_IF_ERROR(adapter.Read(354));
+  if (!dkim_signature_.empty()) {
+    // Written ahead of the message data rather than inserted into it, so that
+    // the message is not moved. WriteLine adds the header's CRLF.
+    const absl::string_view header = dkim_signature_;
+    RETURN_IF_ERROR(adapter.WriteLine(header.substr(0, header.size() - 2)));
+  }
+  RETURN_IF_ERROR(adapter.WriteLine(data));
+  *data_sent = true;
+  RETURN_IF_ERROR(adapter.Read(250));
   return absl::OkStatus();
 }
 
-absl::Status Smtp::Connect() {
-  return ez::smtp::Connect(*adapter_, username_, password_);
-}
+absl::Status Smtp::Connect() { return session_.Connect(); }
 
-absl::Status Smtp::Disconnect() { return Quit(*adapter_); }
+absl::Status Smtp::Disconnect() { return session_.Disconnect(); }
 
 } // namespace smtp
 } // namespace ez
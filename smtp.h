@@ -17,9 +17,12 @@
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "dkim.h"
+#include "mime_header.h"
 #include "status_macros.h"
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
+#include <chrono>
 #include <map>
 #include <queue>
 #include <sstream>
@@ -27,24 +30,38 @@
 namespace ez {
 namespace smtp {
 
+/** How a connection is secured with tls. StartTls connects in plaintext and
+ * upgrades the connection with the STARTTLS command, typically on port 587.
+ * ImplicitTls performs the tls handshake immediately after connecting, saving
+ * the STARTTLS round trips, typically on port 465. */
+enum TlsMode { StartTls = 0, ImplicitTls = 1 };
+
 /** Interface to connect, read and write SMTP messages over a tls socket. */
 class SmtpAdapter {
 public:
-  // Connects to the SMTP server.
+  // Connects to the SMTP server. With implicit tls, this also performs the tls
+  // handshake.
   virtual absl::Status Connect() = 0;
 
   // Upgrades the connection to tls.
   virtual absl::Status EnableTls() = 0;
 
-  // Reads from the socket confirming the SMTP expected value.
+  // Reads from the socket confirming the SMTP expected value. Returns an
+  // Unavailable error if the connection was lost or the server is shutting
+  // down (421).
   virtual absl::Status Read(const int expected_return) = 0;
 
-  // Writes the message appending a newline.
+  // Writes the message appending a newline. Returns an Unavailable error if
+  // the connection was lost.
   virtual absl::Status WriteLine(absl::string_view message) = 0;
 
   // Returns the connected hostname.
   virtual std::string Hostname() = 0;
 
+  // Returns the reply received by the last Read, valid until the next Read.
+  // Empty if nothing was received or the adapter does not keep replies.
+  virtual absl::string_view LastReply() { return ""; }
+
   // Disconnects from the SMTP server.
   virtual void Disconnect() = 0;
 
@@ -52,18 +69,53 @@ public:
   virtual void EnableLogging() = 0;
 };
 
+/** Checks the status code at the start of an SMTP reply, returning an
+ * Unavailable error for an unexpected 421 as required of SmtpAdapter::Read,
+ * an Aborted error for other transient (4xx) replies and otherwise an Internal
+ * error. */
+absl::Status CheckReply(absl::string_view reply, int expected_return);
+
+/** Resources shared by the connections of many adapters: the io_service that
+ * runs their sockets and the ssl context holding the tls configuration, so
+ * that each connection only holds its socket and buffers. Share one per
+ * process, or one per relay where relays need different tls configuration. */
+class SmtpContext {
+public:
+  SmtpContext() : ssl_context_(boost::asio::ssl::context::tlsv12) {
+    // Frees a connection's tls buffers while it is idle.
+    SSL_CTX_set_mode(ssl_context_.native_handle(), SSL_MODE_RELEASE_BUFFERS);
+  }
+
+  /** Returns the context shared by the process, which adapters use unless
+   * they are given another. */
+  static std::shared_ptr<SmtpContext> Default();
+
+  boost::asio::io_service &io_service() { return io_service_; }
+
+  boost::asio::ssl::context &ssl_context() { return ssl_context_; }
+
+private:
+  boost::asio::io_service io_service_;
+  boost::asio::ssl::context ssl_context_;
+};
+
 /** Concrete implementation of SmtpAdapter. */
 class SmtpAdapterImpl : public SmtpAdapter {
 public:
   typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket> SslSocket;
 
-  SmtpAdapterImpl(absl::string_view hostname, const int port)
-      : hostname_(std::string(hostname)), port_(port),
-        ssl_context_(boost::asio::ssl::context::tlsv12), enable_tls_(false) {}
+  SmtpAdapterImpl(
+      absl::string_view hostname, const int port, TlsMode tls_mode = StartTls,
+      std::shared_ptr<SmtpContext> context = SmtpContext::Default())
+      : hostname_(std::string(hostname)), port_(port), tls_mode_(tls_mode),
+        context_(std::move(context)), enable_tls_(false), log_(false) {}
 
   absl::Status Connect() override;
 
   absl::Status EnableTls() override {
+    if (!socket_) {
+      return absl::FailedPreconditionError("Not connected");
+    }
     boost::system::error_code error;
     socket_->handshake(SslSocket::client, error);
     if (error) {
@@ -81,6 +133,8 @@ public:
     return socket_->next_layer().remote_endpoint().address().to_string();
   }
 
+  absl::string_view LastReply() override { return reply_; }
+
   void Disconnect() override {
     enable_tls_ = false;
     socket_.reset();
@@ -91,9 +145,13 @@ public:
 private:
   std::string hostname_;
   const int port_;
-  boost::asio::io_service io_service_;
-  boost::asio::ssl::context ssl_context_;
+  const TlsMode tls_mode_;
+  std::shared_ptr<SmtpContext> context_;
   boost::shared_ptr<SslSocket> socket_;
+  std::string reply_;
+  // The command being written, kept to reuse its capacity. Longer lines are
+  // not copied, so it stays small.
+  std::string output_;
   bool enable_tls_;
   bool log_;
 };
@@ -112,6 +170,15 @@ struct Sender {
   std::string name;
 };
 
+/** A complete email, for callers that queue emails before sending them. */
+struct Email {
+  Sender sender;
+  std::vector<Recipient> recipients;
+  std::string subject;
+  std::string body;
+  std::string content_type;
+};
+
 /** Interface for building and sending an email. */
 class Builder {
 public:
@@ -143,13 +210,69 @@ public:
   virtual absl::Status SendBatch() = 0;
 };
 
+/** An authorized connection to the SMTP server. Tracks when the connection
+ * was last used so that an idle session can be probed with NOOP before it is
+ * reused, and reconnects when the server has dropped it. */
+class Session {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  Session(SmtpAdapter &adapter, absl::string_view username,
+          absl::string_view password, TlsMode tls_mode = StartTls)
+      : adapter_(adapter), username_(std::string(username)),
+        password_(std::string(password)), tls_mode_(tls_mode),
+        connected_(false), keepalive_interval_(std::chrono::seconds(30)) {}
+
+  /** Connects and authorizes with the SMTP server. If there is a failure, it
+   * will automatically disconnect. */
+  absl::Status Connect();
+
+  /** Sends QUIT and disconnects from the SMTP server. Does nothing if the
+   * session is not connected, e.g. after a failed reconnect. */
+  absl::Status Disconnect();
+
+  /** Disconnects without sending QUIT, e.g. after a failed transaction. */
+  void Close();
+
+  /** Drops the current connection and connects again. */
+  absl::Status Reconnect();
+
+  /** Sends a NOOP if the session has been idle for at least the keepalive
+   * interval. If the NOOP fails for any reason, reconnects. */
+  absl::Status KeepAlive();
+
+  /** Marks the session as active, resetting the idle timer. */
+  void Touch() { last_activity_ = Clock::now(); }
+
+  /** Sets how long the session may be idle before it is probed. */
+  void SetKeepAliveInterval(Clock::duration interval) {
+    keepalive_interval_ = interval;
+  }
+
+  bool connected() const { return connected_; }
+
+  SmtpAdapter &adapter() { return adapter_; }
+
+  /** Returns the buffer that commands are encoded in. It is reused for every
+   * command of the session, so that it stops allocating once it has grown to
+   * fit the longest. */
+  std::string *command_buffer() { return &command_; }
+
+private:
+  SmtpAdapter &adapter_;
+  std::string username_;
+  std::string password_;
+  std::string command_;
+  const TlsMode tls_mode_;
+  bool connected_;
+  Clock::duration keepalive_interval_;
+  Clock::time_point last_activity_;
+};
+
 /** Concrete implementation of Builder. */
 class BuilderImpl : public Builder {
 public:
-  BuilderImpl(SmtpAdapter &adapter, absl::string_view username,
-              absl::string_view password)
-      : username_(std::string(username)), password_(std::string(password)),
-        adapter_(adapter) {}
+  explicit BuilderImpl(Session &session) : session_(session) {}
 
   BuilderImpl &SetSubject(absl::string_view subject) override {
     subject_ = subject;
@@ -187,25 +310,51 @@ public:
 
   absl::Status SendBatch() override;
 
-  BuilderImpl &Reset() {
-    subject_ = "";
-    body_ = "";
-    sender_.address = "";
-    sender_.name = "";
-    content_type_ = "";
-    recipients_.clear();
+  BuilderImpl &SetEmail(const Email &email) {
+    sender_ = email.sender;
+    recipients_ = email.recipients;
+    subject_ = email.subject;
+    body_ = email.body;
+    content_type_ = email.content_type;
     return *this;
   }
 
+  /** Signs emails with DKIM when the signer has a key for the sender's
+   * domain. */
+  void SetDkimSigner(std::shared_ptr<const DkimSigner> dkim_signer) {
+    dkim_signer_ = std::move(dkim_signer);
+  }
+
+  /** Returns whether the message data of the last SendBatch was written. If
+   * so, the server may have accepted it even if SendBatch failed. */
+  bool data_sent() const { return data_sent_; }
+
+  /** Clears the email. A large body is freed, so that idle sessions stay
+   * small. */
+  BuilderImpl &Reset();
+
 private:
   std::vector<Recipient> recipients_;
   Sender sender_;
   std::string subject_;
   std::string body_;
   std::string content_type_;
-  std::string username_;
-  std::string password_;
-  SmtpAdapter &adapter_;
+  Session &session_;
+  std::shared_ptr<const DkimSigner> dkim_signer_;
+  bool data_sent_ = false;
+  // Header scratch space, reused by each message so that a batch of similar
+  // emails does not allocate.
+  std::vector<Mailbox> mailboxes_;
+  // The DKIM-Signature header field of the message, or empty if unsigned.
+  std::string dkim_signature_;
+
+  // Encodes the message data into data, and its DKIM-Signature into
+  // dkim_signature_ if there is a DKIM key for the sender's domain.
+  absl::Status EncodeData(std::string *data);
+
+  // Runs a single mail transaction. Sets data_sent once the message has been
+  // fully written, after which it must not be resent.
+  absl::Status SendMessage(absl::string_view data, bool *data_sent);
 };
 
 /** Sends email(s) using SMTP.
@@ -246,23 +395,43 @@ private:
  *                         .SendBatch());
  *     return smtp.Disconnect();
  *   }
+ *
+ * In batch mode, a session that has been idle for longer than the keepalive
+ * interval is probed with NOOP before the next SendBatch, and a message is
+ * resent over a new connection if the server dropped the connection (or
+ * replied 421) before the message data was sent. Call KeepAlive periodically
+ * to keep an idle session open between bursts.
+ *
+ * By default the connection is upgraded with STARTTLS. For servers that expect
+ * tls from the start (SMTPS, typically port 465), pass ImplicitTls:
+ *
+ *   Smtp smtp("smtp.sendgrid.net", 465, "username", "password", ImplicitTls);
+ *
+ * This saves the plaintext greeting and STARTTLS round trips on every
+ * connection, which is most noticeable with Send, as it connects for each
+ * email.
  */
 class Smtp {
 public:
+  /** The adapter must perform the tls handshake in Connect if tls_mode is
+   * ImplicitTls. */
   Smtp(absl::string_view username, absl::string_view password,
-       std::shared_ptr<SmtpAdapter> adapter)
-      : username_(std::string(username)), password_(std::string(password)),
-        adapter_(std::move(adapter)), builder_(*adapter_, username_, password) {
-  }
+       std::shared_ptr<SmtpAdapter> adapter, TlsMode tls_mode = StartTls)
+      : adapter_(std::move(adapter)),
+        session_(*adapter_, username, password, tls_mode), builder_(session_) {}
 
   Smtp(absl::string_view hostname, const int port, absl::string_view username,
-       absl::string_view password)
+       absl::string_view password, TlsMode tls_mode = StartTls)
       : Smtp(username, password,
-             std::make_shared<SmtpAdapterImpl>(hostname, port)) {}
+             std::make_shared<SmtpAdapterImpl>(hostname, port, tls_mode),
+             tls_mode) {}
 
   /** Returns a Builder that may be used to construct and send an email. */
   Builder &NewEmail() { return builder_.Reset(); }
 
+  /** Returns a Builder populated with the given email. */
+  Builder &NewEmail(const Email &email) { return builder_.SetEmail(email); }
+
   /** Connects and authorizes with the SMTP server. Only call this in batch
    * mode prior to sending emails. If there is a failure, it will
    * automatically disconnect. */
@@ -271,14 +440,39 @@ public:
   /** Disconnects from the SMTP server. Only use this in batch mode. */
   absl::Status Disconnect();
 
+  /** Keeps a batch mode session open by sending a NOOP if it has been idle
+   * for at least the keepalive interval, reconnecting if the server has
+   * dropped it. */
+  absl::Status KeepAlive() { return session_.KeepAlive(); }
+
+  /** Sets how long a batch mode session may be idle before it is probed with
+   * NOOP. Defaults to 30 seconds. */
+  void SetKeepAliveInterval(Session::Clock::duration interval) {
+    session_.SetKeepAliveInterval(interval);
+  }
+
   /** Enables logging to stdout which will show the SMTP traffic, intended
    * only for debugging. */
   void EnableLogging() { adapter_->EnableLogging(); }
 
+  /** Signs emails with DKIM when the signer has a key for the sender's
+   * domain. The signer may be shared between Smtp instances. */
+  void SetDkimSigner(std::shared_ptr<const DkimSigner> dkim_signer) {
+    builder_.SetDkimSigner(std::move(dkim_signer));
+  }
+
+  /** Returns whether the message data of the last email sent was written to
+   * the server. If it failed before then, the server did not accept it and it
+   * is safe to send again, e.g. through another server. */
+  bool data_sent() const { return builder_.data_sent(); }
+
+  /** Returns whether a batch mode session is connected. It is not after
+   * Connect fails, or after SendBatch fails to reconnect. */
+  bool connected() const { return session_.connected(); }
+
 private:
-  std::string username_;
-  std::string password_;
   std::shared_ptr<SmtpAdapter> adapter_;
+  Session session_;
   BuilderImpl builder_;
 };
 
@@ -0,0 +1,215 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "smtp.h"
+#include <gtest/gtest.h>
+
+#include "fake_smtp_server.h"
+#include "io_uring_adapter.h"
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+// Heap allocations made by the current thread, so that the fake server's
+// threads are not counted.
+thread_local long allocations = 0;
+
+// Not inlined, so that the compiler does not pair malloc and free with the
+// replaced operators and warn about mismatched allocation functions.
+__attribute__((noinline)) void *Allocate(std::size_t size,
+                                         std::size_t alignment = 0) {
+  allocations++;
+  if (size == 0) {
+    size = 1;
+  }
+  if (alignment > alignof(std::max_align_t)) {
+    // aligned_alloc requires the size to be a multiple of the alignment.
+    return std::aligned_alloc(alignment,
+                              (size + alignment - 1) / alignment * alignment);
+  }
+  return std::malloc(size);
+}
+
+__attribute__((noinline)) void Deallocate(void *p) { std::free(p); }
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  if (void *p = Allocate(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  if (void *p = Allocate(size, static_cast<std::size_t>(alignment))) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *p) noexcept { Deallocate(p); }
+
+void operator delete[](void *p) noexcept { Deallocate(p); }
+
+void operator delete(void *p, std::size_t) noexcept { Deallocate(p); }
+
+void operator delete[](void *p, std::size_t) noexcept { Deallocate(p); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  Deallocate(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  Deallocate(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept { Deallocate(p); }
+
+void operator delete[](void *p, std::align_val_t) noexcept { Deallocate(p); }
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  Deallocate(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  Deallocate(p);
+}
+
+void operator delete(void *p, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  Deallocate(p);
+}
+
+void operator delete[](void *p, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  Deallocate(p);
+}
+
+namespace ez {
+namespace smtp {
+namespace {
+
+constexpr int kWarmUpMessages = 3;
+constexpr int kMessages = 100;
+
+// Message data is encoded into a buffer kept by the sending thread, up to
+// 1 MB, and written from it without being copied, or encrypted into the
+// thread's ring, so emails up to about 1 MB are sent without allocating.
+// The sizes cover a single command-sized line, more than a tls record, and
+// many tls records.
+constexpr size_t kBodySizes[] = {256, 20 << 10, 256 << 10};
+
+Email NewTestEmail(size_t body_size) {
+  Email email;
+  email.sender.address = "newsletter-sender@example.com";
+  email.sender.name = "Newsletter";
+  for (const char *address : {"first-recipient@example.com",
+                              "second-recipient@example.com",
+                              "blind-recipient@example.com"}) {
+    Recipient &recipient = email.recipients.emplace_back();
+    recipient.address = address;
+    recipient.name = "Recipient";
+  }
+  email.recipients.back().recipient_type = Blind;
+  email.subject = "Steady state";
+  email.body = std::string(body_size, 'x');
+  return email;
+}
+
+class SmtpAllocationTest
+    : public testing::TestWithParam<std::tuple<Transport, TlsMode, size_t>> {
+public:
+  void SetUp() override {
+    if (transport() == IoUringTransport &&
+        !IoUringSmtpAdapter::IsSupported()) {
+      GTEST_SKIP() << "io_uring is not supported";
+    }
+  }
+
+protected:
+  Transport transport() const { return std::get<0>(GetParam()); }
+  TlsMode tls_mode() const { return std::get<1>(GetParam()); }
+  size_t body_size() const { return std::get<2>(GetParam()); }
+};
+
+TEST_P(SmtpAllocationTest, BatchSendDoesNotAllocatePerMessage) {
+  FakeSmtpServer server(tls_mode());
+  auto port = server.Listen();
+  ASSERT_TRUE(port.ok());
+  std::thread thread([&server] { server.Serve(); });
+  Smtp smtp("username", "password",
+            NewSmtpAdapter("127.0.0.1", *port, tls_mode(), transport()),
+            tls_mode());
+  ASSERT_TRUE(smtp.Connect().ok());
+  const Email email = NewTestEmail(body_size());
+
+  // The buffers grow to fit the first messages.
+  for (int i = 0; i < kWarmUpMessages; i++) {
+    ASSERT_TRUE(smtp.NewEmail(email).SendBatch().ok());
+  }
+  int failures = 0;
+  const long before = allocations;
+  for (int i = 0; i < kMessages; i++) {
+    if (!smtp.NewEmail(email).SendBatch().ok()) {
+      failures++;
+    }
+  }
+  const long allocated = allocations - before;
+
+  EXPECT_EQ(failures, 0);
+  EXPECT_EQ(allocated, 0) << "Heap allocations in " << kMessages
+                          << " messages";
+  EXPECT_TRUE(smtp.Disconnect().ok());
+  server.Stop();
+  thread.join();
+  EXPECT_EQ(server.messages().size(), kWarmUpMessages + kMessages);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    TransportsTlsModesAndSizes, SmtpAllocationTest,
+    testing::Combine(testing::Values(AsioTransport, IoUringTransport),
+                     testing::Values(StartTls, ImplicitTls),
+                     testing::ValuesIn(kBodySizes)));
+
+} // namespace
+} // namespace smtp
+} // namespace ez
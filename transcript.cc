@@ -0,0 +1,334 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "transcript.h"
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace ez {
+namespace smtp {
+namespace {
+
+// The file starts with a magic number and version, followed by each event as
+// its type byte and then varints for the microseconds since the previous
+// event started, the duration in microseconds, the status code and the size
+// of the data, followed by the data.
+constexpr absl::string_view kMagic = "EZTR\x01";
+
+constexpr int kMaxCode = static_cast<int>(absl::StatusCode::kUnauthenticated);
+
+const char *TypeName(TranscriptEvent::Type type) {
+  switch (type) {
+  case TranscriptEvent::ConnectEvent:
+    return "Connect";
+  case TranscriptEvent::EnableTlsEvent:
+    return "EnableTls";
+  case TranscriptEvent::ReadEvent:
+    return "Read";
+  case TranscriptEvent::WriteEvent:
+    return "WriteLine";
+  case TranscriptEvent::DisconnectEvent:
+    return "Disconnect";
+  }
+  return "Unknown";
+}
+
+void AppendVarint(uint64_t value, std::string *output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+bool ConsumeVarint(absl::string_view *input, uint64_t *value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && !input->empty(); shift += 7) {
+    const uint8_t byte = input->front();
+    input->remove_prefix(1);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::chrono::microseconds Elapsed(std::chrono::steady_clock::time_point start,
+                                  std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+}
+
+// Returns the DKIM-Signature header field without the values of its
+// timestamp (t=) and signature (b=) tags, which change on every send.
+std::string WithoutVolatileDkimTags(absl::string_view header) {
+  std::string result;
+  for (absl::string_view tag : absl::StrSplit(header, ';')) {
+    const absl::string_view name =
+        absl::StripAsciiWhitespace(tag.substr(0, tag.find('=')));
+    absl::StrAppend(&result, name == "t" || name == "b" ? name : tag, ";");
+  }
+  return result;
+}
+
+// Returns whether a line written during replay matches the recorded line.
+bool MatchesRecordedLine(absl::string_view recorded, absl::string_view line) {
+  if (recorded == line || recorded == Transcript::kRedacted) {
+    return true;
+  }
+  return absl::StartsWithIgnoreCase(recorded, "DKIM-Signature:") &&
+         absl::StartsWithIgnoreCase(line, "DKIM-Signature:") &&
+         WithoutVolatileDkimTags(recorded) == WithoutVolatileDkimTags(line);
+}
+
+} // namespace
+
+constexpr absl::string_view Transcript::kRedacted;
+
+std::string Transcript::Serialize() const {
+  std::string output(kMagic);
+  std::chrono::microseconds previous(0);
+  for (const TranscriptEvent &event : events_) {
+    output.push_back(static_cast<char>(event.type));
+    AppendVarint(event.start.count() - previous.count(), &output);
+    AppendVarint(event.duration.count(), &output);
+    AppendVarint(static_cast<uint64_t>(event.code), &output);
+    AppendVarint(event.data.size(), &output);
+    output.append(event.data);
+    previous = event.start;
+  }
+  return output;
+}
+
+absl::StatusOr<Transcript> Transcript::Parse(absl::string_view data) {
+  if (!absl::StartsWith(data, kMagic)) {
+    return absl::InvalidArgumentError("Not a transcript");
+  }
+  data.remove_prefix(kMagic.size());
+  Transcript transcript;
+  std::chrono::microseconds start(0);
+  while (!data.empty()) {
+    const uint8_t type = data.front();
+    data.remove_prefix(1);
+    uint64_t delta, duration, code, size;
+    if (type > TranscriptEvent::DisconnectEvent ||
+        !ConsumeVarint(&data, &delta) || !ConsumeVarint(&data, &duration) ||
+        !ConsumeVarint(&data, &code) || code > kMaxCode ||
+        !ConsumeVarint(&data, &size) || size > data.size()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Corrupt transcript event ", transcript.events_.size()));
+    }
+    start += std::chrono::microseconds(delta);
+    TranscriptEvent event;
+    event.type = static_cast<TranscriptEvent::Type>(type);
+    event.start = start;
+    event.duration = std::chrono::microseconds(duration);
+    event.code = static_cast<absl::StatusCode>(code);
+    event.data = std::string(data.substr(0, size));
+    data.remove_prefix(size);
+    transcript.Add(std::move(event));
+  }
+  return transcript;
+}
+
+absl::Status Transcript::Save(const std::string &path) const {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << Serialize();
+  file.close();
+  if (!file) {
+    return absl::UnavailableError(absl::StrCat("Unable to write ", path));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Transcript> Transcript::Load(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return absl::NotFoundError(absl::StrCat("Unable to read ", path));
+  }
+  std::stringstream data;
+  data << file.rdbuf();
+  return Parse(data.str());
+}
+
+RecordingSmtpAdapter::RecordingSmtpAdapter(
+    std::shared_ptr<SmtpAdapter> adapter)
+    : adapter_(std::move(adapter)), epoch_(Clock::now()), redact_next_(false) {
+}
+
+absl::Status RecordingSmtpAdapter::Connect() {
+  const auto start = Clock::now();
+  absl::Status status = adapter_->Connect();
+  Record(TranscriptEvent::ConnectEvent, start, status,
+         status.ok() ? adapter_->Hostname() : "");
+  redact_next_ = false;
+  return status;
+}
+
+absl::Status RecordingSmtpAdapter::EnableTls() {
+  const auto start = Clock::now();
+  absl::Status status = adapter_->EnableTls();
+  Record(TranscriptEvent::EnableTlsEvent, start, status, "");
+  return status;
+}
+
+absl::Status RecordingSmtpAdapter::Read(const int expected_return) {
+  const auto start = Clock::now();
+  absl::Status status = adapter_->Read(expected_return);
+  // A reply is replayed rather than the status, which depends on the expected
+  // return. Without one, the read itself failed.
+  const absl::string_view reply = adapter_->LastReply();
+  Record(TranscriptEvent::ReadEvent, start,
+         reply.empty() ? status : absl::OkStatus(), std::string(reply));
+  return status;
+}
+
+absl::Status RecordingSmtpAdapter::WriteLine(absl::string_view message) {
+  const auto start = Clock::now();
+  absl::Status status = adapter_->WriteLine(message);
+  Record(TranscriptEvent::WriteEvent, start, status,
+         redact_next_ ? std::string(Transcript::kRedacted)
+                      : std::string(message));
+  redact_next_ = absl::StartsWithIgnoreCase(message, "AUTH ");
+  return status;
+}
+
+void RecordingSmtpAdapter::Disconnect() {
+  const auto start = Clock::now();
+  adapter_->Disconnect();
+  Record(TranscriptEvent::DisconnectEvent, start, absl::OkStatus(), "");
+}
+
+void RecordingSmtpAdapter::Record(TranscriptEvent::Type type,
+                                  Clock::time_point start,
+                                  const absl::Status &status,
+                                  std::string data) {
+  TranscriptEvent event;
+  event.type = type;
+  event.start = Elapsed(epoch_, start);
+  event.duration = Elapsed(start, Clock::now());
+  event.code = status.code();
+  // A failed write keeps its line, so that the replay can match it.
+  event.data = status.ok() || type == TranscriptEvent::WriteEvent
+                   ? std::move(data)
+                   : std::string(status.message());
+  transcript_.Add(std::move(event));
+}
+
+ReplaySmtpAdapter::ReplaySmtpAdapter(Transcript transcript,
+                                     const double time_scale)
+    : transcript_(std::move(transcript)), time_scale_(time_scale), next_(0),
+      log_(false) {}
+
+absl::Status ReplaySmtpAdapter::Connect() {
+  auto event = Next(TranscriptEvent::ConnectEvent);
+  if (!event.ok()) {
+    return event.status();
+  }
+  if ((*event)->code != absl::StatusCode::kOk) {
+    return absl::Status((*event)->code, (*event)->data);
+  }
+  hostname_ = (*event)->data;
+  return absl::OkStatus();
+}
+
+absl::Status ReplaySmtpAdapter::EnableTls() {
+  auto event = Next(TranscriptEvent::EnableTlsEvent);
+  if (!event.ok()) {
+    return event.status();
+  }
+  return absl::Status((*event)->code, (*event)->data);
+}
+
+absl::Status ReplaySmtpAdapter::Read(const int expected_return) {
+  reply_.clear();
+  auto event = Next(TranscriptEvent::ReadEvent);
+  if (!event.ok()) {
+    return event.status();
+  }
+  if ((*event)->code != absl::StatusCode::kOk) {
+    return absl::Status((*event)->code, (*event)->data);
+  }
+  // Recorded from an adapter that does not keep replies.
+  if ((*event)->data.empty()) {
+    return absl::OkStatus();
+  }
+  reply_ = (*event)->data;
+  if (log_) {
+    std::cout << reply_;
+  }
+  return CheckReply(reply_, expected_return);
+}
+
+absl::Status ReplaySmtpAdapter::WriteLine(absl::string_view message) {
+  if (next_ < transcript_.events().size()) {
+    const TranscriptEvent &event = transcript_.events()[next_];
+    if (event.type == TranscriptEvent::WriteEvent &&
+        !MatchesRecordedLine(event.data, message)) {
+      return absl::FailedPreconditionError(
+          absl::StrCat("Transcript event ", next_, " wrote \"", event.data,
+                       "\", not \"", message, "\""));
+    }
+  }
+  auto event = Next(TranscriptEvent::WriteEvent);
+  if (!event.ok()) {
+    return event.status();
+  }
+  if (log_) {
+    std::cout << message << "\r\n";
+  }
+  if ((*event)->code != absl::StatusCode::kOk) {
+    return absl::Status((*event)->code, "The recorded write failed");
+  }
+  return absl::OkStatus();
+}
+
+void ReplaySmtpAdapter::Disconnect() {
+  // Disconnect cannot fail, so a call that was not recorded is ignored.
+  if (next_ < transcript_.events().size() &&
+      transcript_.events()[next_].type == TranscriptEvent::DisconnectEvent) {
+    next_++;
+  }
+}
+
+absl::StatusOr<const TranscriptEvent *>
+ReplaySmtpAdapter::Next(TranscriptEvent::Type type) {
+  if (next_ == transcript_.events().size()) {
+    return absl::FailedPreconditionError(
+        absl::StrCat(TypeName(type), " called after the end of the transcript"));
+  }
+  const TranscriptEvent &event = transcript_.events()[next_];
+  if (event.type != type) {
+    return absl::FailedPreconditionError(
+        absl::StrCat(TypeName(type), " called, but transcript event ", next_,
+                     " is ", TypeName(event.type)));
+  }
+  next_++;
+  if (time_scale_ > 0) {
+    std::this_thread::sleep_for(std::chrono::duration_cast<
+                                std::chrono::microseconds>(
+        event.duration * time_scale_));
+  }
+  return &event;
+}
+
+} // namespace smtp
+} // namespace ez
@@ -0,0 +1,172 @@
+// EZ-SMTP Copyright 2026 Jim Rogers (jimrogerz@gmail.com).
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef EZ_TRANSCRIPT_H
+#define EZ_TRANSCRIPT_H
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "smtp.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ez {
+namespace smtp {
+
+/** One call made on an SmtpAdapter and its outcome. */
+struct TranscriptEvent {
+  enum Type {
+    ConnectEvent = 0,
+    EnableTlsEvent = 1,
+    ReadEvent = 2,
+    WriteEvent = 3,
+    DisconnectEvent = 4,
+  };
+
+  Type type = ConnectEvent;
+
+  // When the call started, relative to the start of the transcript.
+  std::chrono::microseconds start = std::chrono::microseconds(0);
+
+  // How long the call took, which for a read is mostly the server's latency.
+  std::chrono::microseconds duration = std::chrono::microseconds(0);
+
+  // The status returned, or Ok for a read that received a reply.
+  absl::StatusCode code = absl::StatusCode::kOk;
+
+  // The line written without its newline, the reply received or the hostname
+  // connected to. Otherwise the error message if the call failed.
+  std::string data;
+};
+
+/** The calls made on an SmtpAdapter over its lifetime, with the data written
+ * and read and their timing, in a compact binary file format. Credentials
+ * sent with AUTH are not recorded. */
+class Transcript {
+public:
+  /** Written in place of the credentials following an AUTH command. */
+  static constexpr absl::string_view kRedacted = "<redacted>";
+
+  void Add(TranscriptEvent event) { events_.push_back(std::move(event)); }
+
+  const std::vector<TranscriptEvent> &events() const { return events_; }
+
+  /** Returns the transcript in the file format. */
+  std::string Serialize() const;
+
+  /** Parses a transcript in the file format. */
+  static absl::StatusOr<Transcript> Parse(absl::string_view data);
+
+  absl::Status Save(const std::string &path) const;
+
+  static absl::StatusOr<Transcript> Load(const std::string &path);
+
+private:
+  std::vector<TranscriptEvent> events_;
+};
+
+/** SmtpAdapter that forwards calls to another adapter, typically an
+ * SmtpAdapterImpl connected to a real relay, and records them to a
+ * Transcript. */
+class RecordingSmtpAdapter : public SmtpAdapter {
+public:
+  explicit RecordingSmtpAdapter(std::shared_ptr<SmtpAdapter> adapter);
+
+  absl::Status Connect() override;
+
+  absl::Status EnableTls() override;
+
+  absl::Status Read(int expected_return) override;
+
+  absl::Status WriteLine(absl::string_view message) override;
+
+  std::string Hostname() override { return adapter_->Hostname(); }
+
+  absl::string_view LastReply() override { return adapter_->LastReply(); }
+
+  void Disconnect() override;
+
+  void EnableLogging() override { adapter_->EnableLogging(); }
+
+  const Transcript &transcript() const { return transcript_; }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  // Records an event for a call that started at the given time.
+  void Record(TranscriptEvent::Type type, Clock::time_point start,
+              const absl::Status &status, std::string data);
+
+  std::shared_ptr<SmtpAdapter> adapter_;
+  Transcript transcript_;
+  Clock::time_point epoch_;
+  // Whether the last line written was an AUTH command, so the next line holds
+  // credentials.
+  bool redact_next_;
+};
+
+/** SmtpAdapter that plays back a Transcript without a network. Each call
+ * must match the next recorded call, and returns the recorded outcome after
+ * the recorded duration multiplied by time_scale. A time_scale of 1 replays
+ * at the original speed, 0.5 at twice the speed and 0 without delays. A call
+ * that does not match the transcript returns a FailedPrecondition error. A
+ * DKIM-Signature matches regardless of its timestamp and signature, which
+ * change on every send.
+ *
+ *   auto transcript = Transcript::Load("relay.transcript");
+ *   Smtp smtp("username", "password",
+ *             std::make_shared<ReplaySmtpAdapter>(*transcript, 0));
+ */
+class ReplaySmtpAdapter : public SmtpAdapter {
+public:
+  explicit ReplaySmtpAdapter(Transcript transcript, double time_scale = 1);
+
+  absl::Status Connect() override;
+
+  absl::Status EnableTls() override;
+
+  absl::Status Read(int expected_return) override;
+
+  absl::Status WriteLine(absl::string_view message) override;
+
+  std::string Hostname() override { return hostname_; }
+
+  absl::string_view LastReply() override { return reply_; }
+
+  void Disconnect() override;
+
+  void EnableLogging() override { log_ = true; }
+
+  /** Returns whether every recorded call has been replayed. */
+  bool Done() const { return next_ == transcript_.events().size(); }
+
+private:
+  // Returns the next event if it has the given type, after its recorded
+  // duration.
+  absl::StatusOr<const TranscriptEvent *> Next(TranscriptEvent::Type type);
+
+  const Transcript transcript_;
+  const double time_scale_;
+  size_t next_;
+  std::string hostname_;
+  std::string reply_;
+  bool log_;
+};
+
+} // namespace smtp
+} // namespace ez
+
+#endif // EZ_TRANSCRIPT_H